@@ -0,0 +1,232 @@
+/**
+ * Contention benchmark of the command queues.
+ * 
+ * Producers push `command::RawCommand` with a payload of the given size
+ * in bursts, consumers drain the queue in batches the same way `App` does.
+ * Handoff latency is the time between creation of the command 
+ * and its dequeue, so it includes waiting on a full queue.
+ * 
+ * Every queue implementation is wrapped into an adapter with the same
+ * interface and runs on the same harness so the results are comparable:
+ *      bool TryPush(command::RawCommand&&);
+ *      size_t TryPopBulk(size_t consumer, OutputIt out, size_t max);
+ *      void DisableSentinel();
+ * 
+ * Usage: chatterfinity_bench [--queue all|cc|scheduler] [--producers N] 
+ *      [--consumers N] [--messages N] [--payload BYTES] [--burst N] [--pause US]
+ */
+#include "Command.hpp"
+#include "ConcurrentQueue.hpp"
+#include "Environment.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = command::Clock;
+using Nanoseconds = std::chrono::nanoseconds;
+
+struct Options {
+    std::string queue { "all" };
+    std::size_t producers { 2 };
+    std::size_t consumers { 2 };
+    // per producer
+    std::size_t messages { 100'000 };
+    // size of the parameter's value
+    std::size_t payload { 32 };
+    // number of messages pushed back-to-back
+    std::size_t burst { 1 };
+    // pause between bursts
+    std::chrono::microseconds pause { 0 };
+};
+
+struct Result {
+    std::size_t messages { 0 };
+    Nanoseconds elapsed { 0 };
+    // sorted handoff latencies
+    std::vector<Nanoseconds::rep> latency;
+};
+
+class CcQueueAdapter {
+public:
+    static constexpr std::string_view kName { "CcQueue" };
+
+    explicit CcQueueAdapter(std::size_t /* consumers */) {}
+
+    bool TryPush(command::RawCommand&& cmd) {
+        return queue_.TryPush(std::move(cmd));
+    }
+
+    template<typename OutputIt>
+    std::size_t TryPopBulk(std::size_t /* consumer */, OutputIt out, std::size_t max) {
+        return queue_.TryPopBulk(out, max);
+    }
+
+    void DisableSentinel() {
+        queue_.DisableSentinel();
+    }
+
+private:
+    CcQueue<command::RawCommand, cst::kQueueCapacity> queue_;
+};
+
+class SchedulerAdapter {
+public:
+    static constexpr std::string_view kName { "Scheduler" };
+
+    explicit SchedulerAdapter(std::size_t consumers) 
+        : queue_ { consumers, command::kPriorityCapacity }
+    {}
+
+    bool TryPush(command::RawCommand&& cmd) {
+        return queue_.TryPush(std::move(cmd), command::kFetch);
+    }
+
+    template<typename OutputIt>
+    std::size_t TryPopBulk(std::size_t consumer, OutputIt out, std::size_t max) {
+        return queue_.TryPopBulk(consumer, out, max);
+    }
+
+    void DisableSentinel() {
+        queue_.DisableSentinel();
+    }
+
+private:
+    command::Queue queue_;
+};
+
+template<typename Queue>
+Result Run(const Options& options) {
+    // the same batch size as `App` uses
+    constexpr std::size_t kBatchSize { 16 };
+
+    Queue queue { options.consumers };
+    const std::string payload(options.payload, 'x');
+    std::atomic<bool> start { false };
+
+    std::vector<std::vector<Nanoseconds::rep>> samples(options.consumers);
+    std::vector<std::thread> consumers;
+    for (std::size_t i = 0; i < options.consumers; i++) {
+        consumers.emplace_back([&, i]() {
+            auto& latency = samples[i];
+            latency.reserve(options.producers * options.messages / options.consumers);
+            std::vector<command::RawCommand> batch;
+            batch.reserve(kBatchSize);
+            while (queue.TryPopBulk(i, std::back_inserter(batch), kBatchSize)) {
+                const auto now = Clock::now();
+                for (const auto& cmd: batch) {
+                    latency.push_back((now - cmd.GetEnqueueTime()).count());
+                }
+                batch.clear();
+            }
+        });
+    }
+
+    std::vector<std::thread> producers;
+    for (std::size_t i = 0; i < options.producers; i++) {
+        producers.emplace_back([&]() {
+            while (!start.load()) std::this_thread::yield();
+
+            for (std::size_t sent = 0; sent < options.messages; ) {
+                const auto burst = std::min(options.burst, options.messages - sent);
+                for (std::size_t j = 0; j < burst; j++) {
+                    command::RawCommand cmd { "bench", { { "payload", payload } } };
+                    while (!queue.TryPush(std::move(cmd))) {
+                        std::this_thread::yield();
+                    }
+                }
+                sent += burst;
+                if (options.pause.count()) {
+                    std::this_thread::sleep_for(options.pause);
+                }
+            }
+        });
+    }
+
+    const auto first = Clock::now();
+    start.store(true);
+    for (auto& t: producers) t.join();
+    queue.DisableSentinel();
+    for (auto& t: consumers) t.join();
+    const auto last = Clock::now();
+
+    Result result;
+    result.elapsed = last - first;
+    for (auto& latency: samples) {
+        result.latency.insert(result.latency.end(), latency.begin(), latency.end());
+    }
+    result.messages = result.latency.size();
+    std::sort(result.latency.begin(), result.latency.end());
+    return result;
+}
+
+double Percentile(const std::vector<Nanoseconds::rep>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    const auto rank = static_cast<std::size_t>(q * static_cast<double>(sorted.size() - 1));
+    // in microseconds
+    return static_cast<double>(sorted[rank]) / 1000.0;
+}
+
+void Report(std::string_view name, const Options& options, const Result& result) {
+    const double seconds { std::chrono::duration<double>(result.elapsed).count() };
+    std::cout << std::fixed << std::setprecision(2)
+        << name 
+        << " producers " << options.producers
+        << " consumers " << options.consumers
+        << " payload " << options.payload
+        << " burst " << options.burst
+        << " pause " << options.pause.count() << "us"
+        << ": " << static_cast<double>(result.messages) / seconds << " msg/s"
+        << ", handoff latency (us) p50 " << Percentile(result.latency, 0.5)
+        << " p99 " << Percentile(result.latency, 0.99)
+        << " p999 " << Percentile(result.latency, 0.999)
+        << '\n';
+}
+
+template<typename Queue>
+void Bench(const Options& options) {
+    const bool selected { options.queue == "all"
+        || (options.queue == "cc" && Queue::kName == CcQueueAdapter::kName)
+        || (options.queue == "scheduler" && Queue::kName == SchedulerAdapter::kName)
+    };
+    if (selected) {
+        Report(Queue::kName, options, Run<Queue>(options));
+    }
+}
+
+Options Parse(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string_view key { argv[i] };
+        const char *value { argv[i + 1] };
+        const auto number = static_cast<std::size_t>(std::strtoull(value, nullptr, 10));
+        if (key == "--queue") options.queue = value;
+        else if (key == "--producers") options.producers = std::max<std::size_t>(1, number);
+        else if (key == "--consumers") options.consumers = std::max<std::size_t>(1, number);
+        else if (key == "--messages") options.messages = number;
+        else if (key == "--payload") options.payload = number;
+        else if (key == "--burst") options.burst = std::max<std::size_t>(1, number);
+        else if (key == "--pause") options.pause = std::chrono::microseconds(number);
+        else std::cerr << "unknown option: " << key << '\n';
+    }
+    return options;
+}
+
+} // namespace {
+
+int main(int argc, char *argv[]) {
+    const auto options { Parse(argc, argv) };
+    Bench<CcQueueAdapter>(options);
+    Bench<SchedulerAdapter>(options);
+    return 0;
+}
@@ -0,0 +1,229 @@
+/**
+ * Microbenchmark of the connection's outgoing double buffer.
+ *
+ * Every round queues a burst of messages with write callbacks,
+ * swaps the buffers, walks the data the way `async_write` does
+ * and invokes the callbacks, i.e. what `Connection` does per write.
+ * The callback captures a shared pointer and a counter like
+ * the callbacks of `IrcShard` do.
+ *
+ * `SwitchBuffer` is compared against the previous implementation
+ * which kept `std::string` and `std::function` per message.
+ * Heap allocations are counted by replaced global `operator new`.
+ *
+ * Usage: chatterfinity_buffer_bench [--messages N] [--rounds N] [--payload BYTES]
+ */
+#include "SwitchBuffer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+std::atomic<std::size_t> allocations { 0 };
+
+} // namespace {
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1); ptr) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    // messages per round
+    std::size_t messages { 16 };
+    std::size_t rounds { 100'000 };
+    std::size_t payload { 64 };
+};
+
+struct Result {
+    std::chrono::nanoseconds elapsed { 0 };
+    std::size_t allocations { 0 };
+    // prevents the optimizer from dropping the work
+    std::size_t checksum { 0 };
+};
+
+// The previous implementation: string and std::function per message,
+// buffer and callback views are rebuilt on every swap.
+class LegacySwitchBuffer {
+public:
+    using ConstBuffer = boost::asio::const_buffer;
+    using FuncRef = std::reference_wrapper<std::function<void()>>;
+
+    LegacySwitchBuffer(size_t reserved = 10) {
+        for (auto& buffer: buffers_) {
+            buffer.data.reserve(reserved);
+            buffer.callbacks.reserve(reserved);
+        }
+        sequence_.reserve(reserved);
+        callbacks_.reserve(reserved);
+    }
+
+    void Enque(std::string data, std::function<void()> callback) {
+        buffers_[activeBuffer_ ^ 1].data.push_back(std::move(data));
+        buffers_[activeBuffer_ ^ 1].callbacks.push_back(std::move(callback));
+    }
+
+    void SwapBuffers() {
+        sequence_.clear();
+        callbacks_.clear();
+        buffers_[activeBuffer_].data.clear();
+        buffers_[activeBuffer_].callbacks.clear();
+        activeBuffer_ ^= 1;
+
+        auto& buffer = buffers_[activeBuffer_];
+        for (size_t i = 0; i < buffer.data.size(); i++) {
+            sequence_.emplace_back(buffer.data[i].data(), buffer.data[i].size());
+            callbacks_.emplace_back(std::ref(buffer.callbacks[i]));
+        }
+    }
+
+    const std::vector<ConstBuffer>& GetBufferSequence() const noexcept {
+        return sequence_;
+    }
+
+    const std::vector<FuncRef>& GetCallbackSequence() const noexcept {
+        return callbacks_;
+    }
+
+private:
+    struct BufferData {
+        std::vector<std::string> data;
+        std::vector<std::function<void()>> callbacks;
+    };
+
+    std::array<BufferData, 2> buffers_;
+    std::vector<ConstBuffer> sequence_;
+    std::vector<FuncRef> callbacks_;
+    size_t activeBuffer_ { 0 };
+};
+
+struct LegacyAdapter {
+    static constexpr std::string_view kName { "LegacySwitchBuffer" };
+
+    template<typename Callback>
+    void Enque(std::string_view payload, Callback&& callback) {
+        // the old interface took the ownership of the string
+        buffer.Enque(std::string { payload }, std::forward<Callback>(callback));
+    }
+
+    std::size_t Flush() {
+        buffer.SwapBuffers();
+        std::size_t bytes { 0 };
+        for (const auto& sequence: buffer.GetBufferSequence()) {
+            bytes += sequence.size();
+        }
+        for (const auto& callback: buffer.GetCallbackSequence()) {
+            std::invoke(callback);
+        }
+        return bytes;
+    }
+
+    LegacySwitchBuffer buffer;
+};
+
+struct SlabAdapter {
+    static constexpr std::string_view kName { "SwitchBuffer" };
+
+    template<typename Callback>
+    void Enque(std::string_view payload, Callback&& callback) {
+        buffer.Enque(payload, std::forward<Callback>(callback));
+    }
+
+    std::size_t Flush() {
+        buffer.SwapBuffers();
+        const std::size_t bytes { buffer.GetBuffer().size() };
+        buffer.InvokeCallbacks();
+        return bytes;
+    }
+
+    SwitchBuffer buffer;
+};
+
+template<typename Buffer>
+Result Run(const Options& options) {
+    Buffer buffer;
+    const std::string payload(options.payload, 'x');
+    auto owner = std::make_shared<std::size_t>(0);
+
+    auto round = [&]() {
+        for (std::size_t i = 0; i < options.messages; i++) {
+            buffer.Enque(payload, [owner, i]() { *owner += i; });
+        }
+        return buffer.Flush();
+    };
+    // warm up: let the buffers reach their steady capacity
+    for (std::size_t i = 0; i < 4; i++) round();
+
+    Result result;
+    const auto before { allocations.load() };
+    const auto first { Clock::now() };
+    for (std::size_t i = 0; i < options.rounds; i++) {
+        result.checksum += round();
+    }
+    result.elapsed = Clock::now() - first;
+    result.allocations = allocations.load() - before;
+    result.checksum += *owner;
+    return result;
+}
+
+template<typename Buffer>
+void Bench(const Options& options) {
+    const auto result { Run<Buffer>(options) };
+    const double total { static_cast<double>(options.rounds * options.messages) };
+    std::cout << std::fixed << std::setprecision(2)
+        << Buffer::kName
+        << " messages " << options.messages
+        << " payload " << options.payload
+        << ": " << static_cast<double>(result.elapsed.count()) / total << " ns/msg"
+        << ", " << static_cast<double>(result.allocations) / total << " allocs/msg"
+        << " (checksum " << result.checksum << ")\n";
+}
+
+Options Parse(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string_view key { argv[i] };
+        const auto number = static_cast<std::size_t>(std::strtoull(argv[i + 1], nullptr, 10));
+        if (key == "--messages") options.messages = std::max<std::size_t>(1, number);
+        else if (key == "--rounds") options.rounds = std::max<std::size_t>(1, number);
+        else if (key == "--payload") options.payload = number;
+        else std::cerr << "unknown option: " << key << '\n';
+    }
+    return options;
+}
+
+} // namespace {
+
+int main(int argc, char *argv[]) {
+    const auto options { Parse(argc, argv) };
+    Bench<LegacyAdapter>(options);
+    Bench<SlabAdapter>(options);
+    return 0;
+}
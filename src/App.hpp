@@ -3,16 +3,22 @@
 #include <string>
 #include <string_view>
 #include <vector>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <atomic>
 // 3rd party
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
 // common:
 #include "Command.hpp"
-#include "ConcurrentQueue.hpp"
 #include "Translator.hpp"
 #include "Config.hpp"
 #include "Alias.hpp"
 #include "Environment.hpp"
+#include "Runtime.hpp"
+#include "QueueMetrics.hpp"
+#include "ConnectionMetrics.hpp"
 // services:
 #include "Console.hpp"
 #include "Blizzard.hpp"
@@ -25,29 +31,28 @@ class App {
 public:
 
     App() 
-        : commands_ { kSentinel }
+        : commands_ { WorkerCount(), command::kPriorityCapacity, kSentinel }
+        , metrics_ { commands_.GetWorkerCount()
+            , { Dispatcher::kIdentities.begin(), Dispatcher::kIdentities.end() } }
         , config_ { kConfigPath }
         , aliases_ {}
-        , blizzard_ { std::make_shared<service::Blizzard>(&config_, &commands_) }
-        , twitch_ { std::make_shared<service::Twitch>(&config_, &commands_, &aliases_) }
-        , console_ { &commands_, &aliases_}
+        , runtime_ { IoThreadCount() }
+        , blizzard_ { std::make_shared<service::Blizzard>(&config_, &commands_, &runtime_) }
+        , twitch_ { std::make_shared<service::Twitch>(&config_, &commands_, &aliases_, &runtime_) }
+        , console_ { &commands_, &aliases_, &metrics_ }
     {
         config_.Read();
 
-        using namespace std::literals::string_view_literals;
-        std::initializer_list<Translator::Pair> list {
-            {"realm-id"sv,      Translator::CreateHandle<command::RealmID>(*blizzard_) },
-            {"realm-status"sv,  Translator::CreateHandle<command::RealmStatus>(*blizzard_) },
-            {"blizzard-token"sv,Translator::CreateHandle<command::AccessToken>(*blizzard_) },
-            {"arena"sv,         Translator::CreateHandle<command::Arena>(*blizzard_) },
-            
-            {"validate"sv,      Translator::CreateHandle<command::Validate>(*twitch_) },
-            {"login"sv,         Translator::CreateHandle<command::Login>(*twitch_) },
-            {"join"sv,          Translator::CreateHandle<command::Join>(*twitch_) },
-            {"chat"sv,          Translator::CreateHandle<command::Chat>(*twitch_) },
-            {"leave"sv,         Translator::CreateHandle<command::Leave>(*twitch_) }
-        };
-        translator_.Insert(list);
+        translator_.Insert<command::RealmID>(*blizzard_);
+        translator_.Insert<command::RealmStatus>(*blizzard_);
+        translator_.Insert<command::AccessToken>(*blizzard_);
+        translator_.Insert<command::Arena>(*blizzard_);
+
+        translator_.Insert<command::Validate>(*twitch_);
+        translator_.Insert<command::Login>(*twitch_);
+        translator_.Insert<command::Join>(*twitch_);
+        translator_.Insert<command::Chat>(*twitch_);
+        translator_.Insert<command::Leave>(*twitch_);
     }
 
     App(const App&) = delete;
@@ -61,60 +66,141 @@ public:
         for (auto&&worker: workers_) {
             worker.join();
         }
+        // wait for services to finish their jobs before they're destroyed
+        runtime_.Join();
+        // summary of the queue overflows
+        service::Console::Write("expired commands:", expired_.load(), '\n');
+        for (std::size_t lane = 0; lane < command::kPriorityCount; lane++) {
+            const auto stats = commands_.GetStats(lane);
+            service::Console::Write("queue lane", lane
+                , ": high-water", stats.highWater
+                , "pushed", stats.pushed
+                , "dropped", stats.dropped
+                , "displaced", stats.displaced
+                , "coalesced", stats.coalesced
+                , "timeouts", stats.timeouts, '\n');
+        }
+        service::Console::Write(metrics_.Report());
+        service::Console::Write(ConnectionMetrics::Report());
     }
 
     void Run() {
         // create consumers
-        for (std::size_t i = 0; i < kWorkerCount; i++) {
-            workers_.emplace_back([this]() {
+        for (std::size_t i = 0; i < commands_.GetWorkerCount(); i++) {
+            workers_.emplace_back([this, i]() {
+                // buffers are reused by all batches of the worker
+                std::vector<command::RawCommand> batch;
+                batch.reserve(kBatchSize);
+                command::Args params;
                 // TODO: this stuff in while loop may throw
-                while (true) {
-                    auto cmd { commands_.TryPop() };
-                    if (!cmd) {
-                        service::Console::Write(std::this_thread::get_id(), ":  -> queue is empty\n");
+                for (;;) {
+                    command::TimePoint waitStart {};
+                    if constexpr (command::QueueMetrics::kEnabled) {
+                        waitStart = command::Clock::now();
+                    }
+                    if (!commands_.TryPopBulk(i, std::back_inserter(batch), kBatchSize)) {
                         break;
                     }
-                    if (auto handle = translator_.GetHandle(cmd->command_); handle) {
-                        Translator::Params params;
-                        params.reserve(cmd->params_.size());
-                        for (auto&& [k, v]: cmd->params_) {
-                            params.emplace_back(command::ParamView{ k, v });
-                        }
-                        // TODO: this stuff may throw run-time errors, see: 
-                        // <code> // IrcShard.cpp
-                        // void IrcShard::Invoker::Execute(command::Validate);
-                        // </code>
-                        // maybe you should try to catch and process this exception?
-                        std::invoke(*handle, params);
+                    if constexpr (command::QueueMetrics::kEnabled) {
+                        metrics_.OnIdle(i, command::Clock::now() - waitStart);
                     }
-                    else {
-                        service::Console::Write("Can not recognize a command:", cmd->command_, '\n');
+                    for (auto& cmd: batch) {
+                        Dispatch(cmd, params);
                     }
+                    batch.clear();
                 }
+                service::Console::Write(std::this_thread::get_id(), ":  -> queue is empty\n");
             });
         }
         // run services:
 
-        // -> doesn't block
-        blizzard_->Run();
-        twitch_->Run();
+        // -> doesn't block: all services share the runtime's threads
+        runtime_.Run();
         // -> blocks
         console_.Run();
     }
 
 private:
-    // enable/disable sentinel in CcQueue 
+
+    // `params` is a buffer provided by the worker
+    // so it doesn't reallocate for each command
+    void Dispatch(const command::RawCommand& cmd, command::Args& params) {
+        const auto index { Dispatcher::Find(cmd.GetCommand()) };
+        if constexpr (command::QueueMetrics::kEnabled) {
+            // queueing delay only: the service's own latency isn't included
+            metrics_.OnDequeue(index, command::Clock::now() - cmd.GetEnqueueTime());
+        }
+        if (command::IsExpired(cmd.GetDeadline())) {
+            // nobody is waiting for the answer anymore
+            expired_.fetch_add(1, std::memory_order_relaxed);
+            service::Console::Write("Drop expired command:", cmd.GetCommand(), '\n');
+            return;
+        }
+        if (auto handle = translator_.GetHandle(index); handle) {
+            params.clear();
+            cmd.GetParams(params);
+            // pass deadline further so the service can cancel the work
+            command::DeadlineBuffer deadline;
+            if (cmd.GetDeadline() != command::kNoDeadline) {
+                params.emplace_back(command::ParamView{ command::kDeadlineKey
+                    , command::WriteDeadline(cmd.GetDeadline(), deadline) });
+            }
+            // TODO: this stuff may throw run-time errors, see: 
+            // <code> // IrcShard.cpp
+            // void IrcShard::Invoker::Execute(command::Validate);
+            // </code>
+            // maybe you should try to catch and process this exception?
+            std::invoke(*handle, params);
+        }
+        else {
+            service::Console::Write("Can not recognize a command:", cmd.GetCommand(), '\n');
+        }
+    }
+
+    // Workers and io threads share the cores: together they 
+    // don't outnumber them (but there are at least `kMinThreadCount`)
+    static std::size_t ThreadCount() noexcept {
+        const std::size_t cores { std::thread::hardware_concurrency() };
+        return std::max(kMinThreadCount, cores);
+    }
+
+    // half of the threads run the services' I/O
+    static std::size_t IoThreadCount() noexcept {
+        return ThreadCount() / 2;
+    }
+
+    // the rest drain the queue
+    static std::size_t WorkerCount() noexcept {
+        return ThreadCount() - IoThreadCount();
+    }
+
+    // commands passed between services through the queue
+    using Dispatcher = Translator<
+        command::RealmID, command::RealmStatus, command::AccessToken, command::Arena,
+        command::Validate, command::Login, command::Join, command::Chat, command::Leave
+    >;
+
+    // enable/disable sentinel in Scheduler
     static constexpr bool kSentinel { true };
-    static constexpr std::size_t kWorkerCount { 2 };
+    // at least one worker and one io thread
+    static constexpr std::size_t kMinThreadCount { 2 };
+    // max number of commands a worker takes from the queue per wakeup
+    static constexpr std::size_t kBatchSize { 16 };
     static constexpr const char * const kConfigPath { "secret/services.json" };
 
     std::vector<std::thread> workers_;
-    // common queue
+    // number of commands dropped by workers due to their deadline
+    std::atomic<std::size_t> expired_ { 0 };
+    // common queue: work-stealing scheduler drained by `workers_`
     command::Queue commands_;
-    Translator translator_;
+    // consumer-side instrumentation of `commands_`
+    command::QueueMetrics metrics_;
+    Dispatcher translator_;
     // configuration and settings
     Config config_;
     command::AliasTable aliases_;
+    // io_context and threads shared by all services
+    Runtime runtime_;
     // services:
     std::shared_ptr<service::Blizzard> blizzard_;
     std::shared_ptr<service::Twitch> twitch_;
@@ -5,6 +5,7 @@
 #include "Request.hpp"
 #include "Chain.hpp"
 #include "Connection.hpp"
+#include "HttpPool.hpp"
 #include "Domain.hpp"
 
 #include <stdexcept>
@@ -15,10 +16,15 @@ namespace domain = blizzard::domain;
 
 namespace service {
 
-Blizzard::Blizzard(const Config *config, command::Queue * outbox) 
-    : context_ { std::make_shared<boost::asio::io_context>() }
-    , work_ { context_->get_executor() }
+Blizzard::Blizzard(const Config *config
+    , command::Queue * outbox
+    , const Runtime *runtime
+) 
+    : context_ { runtime->GetContext() }
+    , work_ { runtime->MakeWork() }
+    , strand_ { runtime->MakeStrand() }
     , ssl_ { std::make_shared<ssl::context>(ssl::context::method::sslv23_client) }
+    , sessions_ { *ssl_ }
     , invoker_ { std::make_unique<Invoker>(this) }
     , config_ { config }
     , outbox_ { outbox }
@@ -40,57 +46,71 @@ Blizzard::Blizzard(const Config *config, command::Queue * outbox)
     if (error) {
         Console::Write("[blizzard] --error: (*.api.blizzard.com CA)", error.message(), '\n');
     }
+
+    for (auto host: { kApiHost, kAuthHost }) {
+        pools_.emplace(host, std::make_shared<HttpPool>(
+            context_, ssl_, host, kService, kMaxConnectionsPerHost));
+    }
 }
 
 Blizzard::~Blizzard() {
-    Console::Write("  -> close blizzard service\n");
-    // TODO: decide whether I should stop io_context or not?
-    // context_->stop();
-    for (auto& t: threads_) t.join();
+    Console::Write("  -> close blizzard service; expired requests:"
+        , expired_.load(), "failed requests:", failed_.load(), '\n');
+    // Note: runtime must be joined before the service is destroyed
+    // so no handler refers to it
+    sessions_.Clear();
 }
 
 void Blizzard::ResetWork() {
+    // idle keep-alive connections are closed gracefully
+    for (auto& [host, pool]: pools_) {
+        pool->Shutdown();
+    }
     work_.reset();
 }
 
-void Blizzard::Run() {
-    for (size_t i = 0; i < kThreads; i++) {
-        auto worker = [this]() {
-            for (;;) {
-                try {
-                    context_->run();
-                    break;
-                }
-                catch (std::exception& ex) {
-                    Console::Write("[blizzard]: "
-                        "--error: context raises an exceptiom:"
-                        , ex.what(), '\n');
-                }
+std::shared_ptr<HttpPool::Lease> Blizzard::MakeLease(std::string_view host
+    , const std::shared_ptr<Chain>& chain
+) {
+    auto it = pools_.find(host);
+    assert(it != pools_.end() && "Unknown host");
+    // weak: the chain's tasks own the lease
+    return std::make_shared<HttpPool::Lease>(it->second
+        , [service = this, host = it->first, weak = std::weak_ptr<Chain>{ chain }]() {
+            service->OnFailure(host);
+            // nothing to continue with: the tasks 
+            // and the lease they hold are released
+            if (auto chain = weak.lock(); chain) {
+                chain->Cancel();
             }
-        };
-        threads_.emplace_back(std::move(worker));
-    }
+        });
 }
 
-void Blizzard::QueryRealm(Callback continuation) {
-    constexpr const char * const kHost { "eu.api.blizzard.com" };
-    constexpr const char * const kService { "https" };
+void Blizzard::OnExpire(std::string_view command) {
+    expired_.fetch_add(1, std::memory_order_relaxed);
+    Console::Write("[blizzard] drop", command, "request: deadline has passed\n");
+}
 
-    auto connection = std::make_shared<HttpConnection>(
-        context_, ssl_ , kHost, kService, GenerateId()
-    );
+void Blizzard::OnFailure(std::string_view host) {
+    failed_.fetch_add(1, std::memory_order_relaxed);
+    Console::Write("[blizzard] drop request to", host, ": connection failed\n");
+}
+
+void Blizzard::QueryRealm(Callback continuation) {
+    auto chain = std::make_shared<Chain>(strand_);
+    auto lease = MakeLease(kApiHost, chain);
 
     const auto& token = cache_[Domain::kToken];
     assert(token.Get<std::string>());
     auto request = request::blizzard::Realm{ *token.Get<std::string>() }.Build();
 
-    auto readCallback = [weak = utils::WeakFrom<HttpConnection>(connection)
+    auto readCallback = [lease
         , service = this
     ]() {
-        assert(weak.use_count() > 0);
-        auto shared = weak.lock();
 
-        const auto [head, body] = shared->AcquireResponse();
+        const auto [head, body] = lease->Get()->AcquireResponse();
+        // the response is read completely: the connection can serve the next request
+        lease->Release(head.keepAlive_);
         rapidjson::Document json; 
         json.Parse(body.data(), body.size());
         const auto realmId = json["id"].GetUint64();
@@ -102,17 +122,16 @@ void Blizzard::QueryRealm(Callback continuation) {
             , CacheSlot::Duration{ 24 * 60 * 60 });
     };
 
-    auto connect = [connection](Chain::Callback cb) {
-        connection->Connect(std::move(cb));
+    auto connect = [lease](Chain::Callback cb) {
+        lease->Acquire(std::move(cb));
     };
-    auto write = [connection, req = std::move(request)](Chain::Callback cb) {
-        connection->ScheduleWrite(std::move(req), std::move(cb));
+    auto write = [lease, req = std::move(request)](Chain::Callback cb) {
+        lease->Get()->ScheduleWrite(std::move(req), std::move(cb));
     };
-    auto read = [connection](Chain::Callback cb) {
-        connection->Read(std::move(cb));
+    auto read = [lease](Chain::Callback cb) {
+        lease->Get()->Read(std::move(cb));
     };
 
-    auto chain = std::make_shared<Chain>(context_);
     (*chain).Add(std::move(connect))
         .Add(std::move(write))
         .Add(std::move(read), std::move(readCallback));
@@ -131,23 +150,24 @@ void Blizzard::QueryRealmStatus(command::RealmStatus cmd
     assert(token.Get<std::string>());
     assert(realm.Get<domain::Realm>());
 
-    constexpr const char * const kHost { "eu.api.blizzard.com" };
-    constexpr const char * const kService { "https" };
-    
-    auto connection = std::make_shared<HttpConnection>(
-        context_, ssl_ , kHost, kService, GenerateId()
-    );
+    auto chain = std::make_shared<Chain>(strand_);
+    auto lease = MakeLease(kApiHost, chain);
+    chain->SetDeadline(cmd.deadline_, [service = this, lease]() {
+        // don't keep the connection until the lease is destroyed
+        lease->Abandon();
+        service->OnExpire(command::RealmStatus::kIdentity);
+    });
     auto request = request::blizzard::RealmStatus{ realm.Get<domain::Realm>()->id
         , *token.Get<std::string>() }.Build();
 
-    auto readCallback = [weak = utils::WeakFrom<HttpConnection>(connection)
+    auto readCallback = [lease
         , service = this
         , cmd = std::move(cmd)
     ]() {
-        assert(weak.use_count() > 0);
-        auto shared = weak.lock();
 
-        const auto [head, body] = shared->AcquireResponse();
+        const auto [head, body] = lease->Get()->AcquireResponse();
+        // the response is read completely: the connection can serve the next request
+        lease->Release(head.keepAlive_);
 
         std::string message;
         if (domain::RealmStatus response; 
@@ -176,27 +196,34 @@ void Blizzard::QueryRealmStatus(command::RealmStatus cmd
         else { // the source of the command is twitch
             message = "@" + cmd.user_ + ", " + message;
             command::RawCommand raw { "chat", { 
-                command::ParamData { "channel", cmd.channel_ }
-                , { "message", std::move(message) }}
+                command::ParamView { "channel", cmd.channel_ }
+                , { "message", message }}
             };
-            if (!service->outbox_->TryPush(std::move(raw))) {
+            // the request's deadline is met: don't throw the answer away
+            raw.SetDeadline(command::Clock::now() + kReplyDeadline);
+            const auto status = service->outbox_->Push(std::move(raw)
+                , command::kInteractive, kOverflow);
+            if (status == command::Queue::Status::kDropped) {
                 Console::Write("[blizzard] fail to push !realm-status"
                     " response to queue: it is full\n");
             }
+            else if (status == command::Queue::Status::kDisplaced) {
+                Console::Write("[blizzard] push !realm-status response"
+                    " to queue: the oldest reply was dropped\n");
+            }
         }
     };
 
-    auto connect = [connection](Chain::Callback cb) {
-        connection->Connect(std::move(cb));
+    auto connect = [lease](Chain::Callback cb) {
+        lease->Acquire(std::move(cb));
     };
-    auto write = [connection, request = std::move(request)](Chain::Callback cb) {
-        connection->ScheduleWrite(std::move(request), std::move(cb));
+    auto write = [lease, request = std::move(request)](Chain::Callback cb) {
+        lease->Get()->ScheduleWrite(std::move(request), std::move(cb));
     };
-    auto read = [connection](Chain::Callback cb) {
-        connection->Read(std::move(cb));
+    auto read = [lease](Chain::Callback cb) {
+        lease->Get()->Read(std::move(cb));
     };
 
-    auto chain = std::make_shared<Chain>(context_);
     (*chain).Add(std::move(connect))
         .Add(std::move(write))
         .Add(std::move(read), std::move(readCallback));
@@ -207,12 +234,8 @@ void Blizzard::QueryRealmStatus(command::RealmStatus cmd
 }
 
 void Blizzard::AcquireToken(Callback continuation) {
-    constexpr const char * const kHost { "eu.battle.net" };
-    constexpr const char * const kService { "https" };
-
-    auto connection = std::make_shared<HttpConnection>(
-        context_, ssl_ , kHost, kService, GenerateId()
-    );
+    auto chain = std::make_shared<Chain>(strand_);
+    auto lease = MakeLease(kAuthHost, chain);
     const Config::Identity identity { "blizzard" };
 
     const auto secret = GetConfig()->GetSecret(identity);
@@ -223,12 +246,12 @@ void Blizzard::AcquireToken(Callback continuation) {
     
     auto request = request::blizzard::CredentialsExchange(secret->id_, secret->secret_).Build();
     
-    auto readCallback = [weak = utils::WeakFrom<HttpConnection>(connection)
+    auto readCallback = [lease
         , service = this
     ]() {
-        assert(weak.use_count() > 0);
-        auto shared = weak.lock();
-        const auto [head, body] = shared->AcquireResponse();
+        const auto [head, body] = lease->Get()->AcquireResponse();
+        // the response is read completely: the connection can serve the next request
+        lease->Release(head.keepAlive_);
         
         domain::Token token;
         if (!domain::Parse(body, token)) {
@@ -242,17 +265,16 @@ void Blizzard::AcquireToken(Callback continuation) {
             , CacheSlot::Duration(token.expires));
     };
 
-    auto connect = [connection](Chain::Callback cb) {
-        connection->Connect(std::move(cb));
+    auto connect = [lease](Chain::Callback cb) {
+        lease->Acquire(std::move(cb));
     };
-    auto write = [connection, request = std::move(request)](Chain::Callback cb) {
-        connection->ScheduleWrite(std::move(request), std::move(cb));
+    auto write = [lease, request = std::move(request)](Chain::Callback cb) {
+        lease->Get()->ScheduleWrite(std::move(request), std::move(cb));
     };
-    auto read = [connection](Chain::Callback cb) {
-        connection->Read(std::move(cb));
+    auto read = [lease](Chain::Callback cb) {
+        lease->Get()->Read(std::move(cb));
     };
 
-    auto chain = std::make_shared<Chain>(context_);
     (*chain).Add(std::move(connect))
         .Add(std::move(write))
         .Add(std::move(read), std::move(readCallback));
@@ -278,7 +300,7 @@ void Blizzard::Invoker::Execute(command::RealmID) {
         return;
     }
 
-    auto chain = std::make_shared<Chain>(blizzard_->context_);
+    auto chain = std::make_shared<Chain>(blizzard_->strand_);
     if (const auto& token = blizzard_->cache_[Domain::kToken];
         !token.IsValid()) 
     {
@@ -299,6 +321,12 @@ void Blizzard::Invoker::Execute(command::Arena command) {
         , command.channel_, ", player ="
         , command.player_, "]\n");
 
+    if (command::IsExpired(command.deadline_)) {
+        blizzard_->OnExpire(command::Arena::kIdentity);
+        return;
+    }
+    const auto deadline { command.deadline_ };
+
     auto handleResponse = [service = blizzard_, cmd = std::move(command)]() {
         const auto& arena = service->cache_[Domain::kArena];
         assert(arena.Get<domain::Arena>());
@@ -348,14 +376,22 @@ void Blizzard::Invoker::Execute(command::Arena command) {
             Console::Write("[blizzard] send message:", message, "\n");
 
             command::RawCommand raw { "chat", { 
-                command::ParamData { "channel", cmd.channel_ }
-                , { "message", std::move(message) }}
+                command::ParamView { "channel", cmd.channel_ }
+                , { "message", message }}
             };
+            // the request's deadline is met: don't throw the answer away
+            raw.SetDeadline(command::Clock::now() + kReplyDeadline);
             
-            if (!service->outbox_->TryPush(std::move(raw))) {
+            const auto status = service->outbox_->Push(std::move(raw)
+                , command::kInteractive, kOverflow);
+            if (status == command::Queue::Status::kDropped) {
                 Console::Write("[blizzard] fail to push !arena "
                     "response to queue: it is full\n");
             }
+            else if (status == command::Queue::Status::kDisplaced) {
+                Console::Write("[blizzard] push !arena response"
+                    " to queue: the oldest reply was dropped\n");
+            }
         }
     };
 
@@ -367,38 +403,33 @@ void Blizzard::Invoker::Execute(command::Arena command) {
         return;
     }
 
-    constexpr const char * const kHost { "eu.api.blizzard.com" };
-    constexpr const char * const kService { "https" };
-
-    auto connection = std::make_shared<HttpConnection>(
-        blizzard_->context_, blizzard_->ssl_, 
-        kHost, kService, blizzard_->GenerateId()
-    );
+    auto chain = std::make_shared<Chain>(blizzard_->strand_);
+    auto lease = blizzard_->MakeLease(kApiHost, chain);
     
-    auto connect = [connection](Chain::Callback cb) {
-        connection->Connect(std::move(cb));
+    auto connect = [lease](Chain::Callback cb) {
+        lease->Acquire(std::move(cb));
     };
 
-    auto write = [connection, service = blizzard_](Chain::Callback cb) {
+    auto write = [lease, service = blizzard_](Chain::Callback cb) {
         const auto& tokenSlot = service->cache_[Domain::kToken];
         const auto& token = *tokenSlot.Get<std::string>();
         
         constexpr uint64_t kSeason { 2 };
         constexpr uint64_t kTeamSize { 2 };
         auto request = request::blizzard::Arena(kSeason, kTeamSize, token).Build();
-        connection->ScheduleWrite(std::move(request), std::move(cb));
+        lease->Get()->ScheduleWrite(std::move(request), std::move(cb));
     };
 
-    auto read = [connection](Chain::Callback cb) {
-        connection->Read(std::move(cb));
+    auto read = [lease](Chain::Callback cb) {
+        lease->Get()->Read(std::move(cb));
     };
 
-    auto readCallback = [weak = utils::WeakFrom<HttpConnection>(connection)
+    auto readCallback = [lease
         , service = this->blizzard_]() 
     {
-        assert(weak.use_count() > 0);
-        auto shared = weak.lock();
-        const auto [head, body] = shared->AcquireResponse();
+        const auto [head, body] = lease->Get()->AcquireResponse();
+        // the response is read completely: the connection can serve the next request
+        lease->Release(head.keepAlive_);
         if (head.statusCode_ != 200) {
             Console::Write("[blizzard] can't get response: body = \"", body, "\"\n");
             constexpr std::chrono::seconds kLifetime { 30 * 60 };
@@ -421,7 +452,6 @@ void Blizzard::Invoker::Execute(command::Arena command) {
         arena.Insert(std::move(response), kLifetime);
     };
 
-    auto chain = std::make_shared<Chain>(blizzard_->context_);
     if (auto const& token = blizzard_->cache_[Domain::kToken];
         !token.IsValid()) 
     {
@@ -433,11 +463,24 @@ void Blizzard::Invoker::Execute(command::Arena command) {
     chain->Add(std::move(write));
     chain->Add(std::move(read), std::move(readCallback));
     chain->Add(std::move(handleResponse));
+    chain->SetDeadline(deadline, [service = blizzard_, lease]() {
+        // don't keep the connection until the lease is destroyed
+        lease->Abandon();
+        service->OnExpire(command::Arena::kIdentity);
+    });
     chain->Execute();
 }
 
 void Blizzard::Invoker::Execute(command::RealmStatus cmd) {
-    auto chain = std::make_shared<Chain>(blizzard_->context_);
+    if (command::IsExpired(cmd.deadline_)) {
+        blizzard_->OnExpire(command::RealmStatus::kIdentity);
+        return;
+    }
+
+    auto chain = std::make_shared<Chain>(blizzard_->strand_);
+    chain->SetDeadline(cmd.deadline_, [blizzard = blizzard_]() {
+        blizzard->OnExpire(command::RealmStatus::kIdentity);
+    });
 
     if (auto const& token = blizzard_->cache_[Domain::kToken];
         !token.IsValid()) 
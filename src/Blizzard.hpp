@@ -1,6 +1,9 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
+#include <atomic>
+#include <string_view>
 #include <unordered_map>
 
 #include <boost/asio.hpp>
@@ -8,13 +11,16 @@
 
 #include "Command.hpp"
 #include "Cache.hpp"
-#include "ConcurrentQueue.hpp"
 #include "Environment.hpp"
+#include "Runtime.hpp"
+#include "SessionCache.hpp"
+#include "HttpPool.hpp"
 
 namespace ssl = boost::asio::ssl;
 using boost::asio::ip::tcp;
 
 class Config;
+class Chain;
 
 namespace blizzard::domain {
     enum class Domain : std::uint8_t;
@@ -26,7 +32,9 @@ class Blizzard
     : public std::enable_shared_from_this<Blizzard> 
 {
 public:
-    Blizzard(const Config *config, command::Queue *outbox);
+    Blizzard(const Config *config
+        , command::Queue *outbox
+        , const Runtime *runtime);
 
     Blizzard(const Blizzard&) = delete;
     Blizzard(Blizzard&&) = delete;
@@ -40,10 +48,10 @@ public:
     >
     void Execute(Command&& cmd);
 
+    // Let the service finish its jobs and stop.
+    // Other services sharing the runtime aren't affected
     void ResetWork();
 
-    void Run();
-
     const Config* GetConfig() const noexcept {
         return config_;
     }
@@ -57,29 +65,56 @@ private:
 
     void AcquireToken(Callback continuation);
 
-    size_t GenerateId() const;
+    // count request which is cancelled due to its deadline
+    void OnExpire(std::string_view command);
+
+    // count request which failed: connection is broken 
+    // or no connection is available for too long
+    void OnFailure(std::string_view host);
+
+    // new request's handle to the connection to the `host`:
+    // the rest of the `chain` is cancelled when the connection fails
+    std::shared_ptr<HttpPool::Lease> MakeLease(std::string_view host
+        , const std::shared_ptr<Chain>& chain);
 
 private:
     class Invoker;
 
-    using Work = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
     using Domain = blizzard::domain::Domain;
 
-    static constexpr size_t kThreads { 2 };
-    std::vector<std::thread> threads_;
+    // the newest replies are more relevant to the chat than the old ones
+    static constexpr command::Queue::Overflow kOverflow { 
+        command::Queue::Overflow::kDropOldest };
+    // the answer is already paid for: only its delivery to the chat is limited
+    static constexpr std::chrono::seconds kReplyDeadline { 5 };
+
+    static constexpr std::string_view kApiHost { "eu.api.blizzard.com" };
+    static constexpr std::string_view kAuthHost { "eu.battle.net" };
+    static constexpr std::string_view kService { "https" };
+    // max number of simultaneous requests to one host
+    static constexpr size_t kMaxConnectionsPerHost { 4 };
 
     std::unordered_map<Domain, CacheSlot> cache_;
 
-    std::shared_ptr<boost::asio::io_context> context_;
-    Work work_;
+    // shared with other services
+    Runtime::SharedContext context_;
+    Runtime::Work work_;
+    // commands and their chains are executed within it,
+    // so they see consistent `cache_`
+    Runtime::Strand strand_;
     std::shared_ptr<ssl::context> ssl_;
+    // TLS sessions of the connections created with `ssl_`
+    SessionCache sessions_;
+    // keep-alive connections per host; the map isn't modified after construction
+    std::unordered_map<std::string_view, std::shared_ptr<HttpPool>> pools_;
 
     std::unique_ptr<Invoker> invoker_;
     const Config * const config_ { nullptr };
     command::Queue * const outbox_ { nullptr };
-    
-    // connection id
-    static inline size_t lastID_ { 0 };
+    // number of requests cancelled due to their deadline
+    std::atomic<size_t> expired_ { 0 };
+    // number of requests failed due to their connection
+    std::atomic<size_t> failed_ { 0 };
 };
 
 class Blizzard::Invoker {
@@ -97,11 +132,12 @@ private:
 
 template<typename Command, typename Enable>
 inline void Blizzard::Execute(Command&& cmd) {
-    invoker_->Execute(std::forward<Command>(cmd));
-}
-
-inline size_t Blizzard::GenerateId() const {
-    return Blizzard::lastID_++;
+    // don't block the caller (queue's worker): run within the service's strand
+    boost::asio::post(strand_, [self = shared_from_this()
+        , cmd = std::decay_t<Command>{ std::forward<Command>(cmd) }
+    ]() mutable {
+        self->invoker_->Execute(std::move(cmd));
+    });
 }
 
 } // namespace service
\ No newline at end of file
@@ -1,10 +1,9 @@
 #include "Chain.hpp"
 #include <cassert>
 
-Chain::Chain(std::shared_ptr<boost::asio::io_context> context)
-    : context_{ context }
+Chain::Chain(Strand strand)
+    : strand_ { strand }
 {
-    assert(context_);
 }
 
 Chain& Chain::Add(Chain::Callback cb) {
@@ -15,23 +14,49 @@ Chain& Chain::Add(Chain::Callback cb) {
 }
 
 Chain& Chain::Add(Chain::Task task, Chain::Callback cb) {
-    // `hook` will be executed in `task` instead of original callback `cb`
-    auto hook = [self = shared_from_this(), cb = std::move(cb)]() {
-        if (cb) cb();
-        if (!self->chain_.empty()) self->Execute();
-    };
-    chain_.emplace_back(std::move(task), std::move(hook));
+    chain_.emplace_back(std::move(task), std::move(cb));
+    return *this;
+}
+
+Chain& Chain::SetDeadline(Chain::TimePoint deadline, Chain::Callback onExpire) {
+    deadline_ = deadline;
+    onExpire_ = std::move(onExpire);
     return *this;
 }
 
 void Chain::Execute() {
     assert(!chain_.empty());
 
-    boost::asio::post(*context_, [self = shared_from_this()]() {
+    boost::asio::post(strand_, [self = shared_from_this()]() {
         assert(!self->chain_.empty());
 
+        if (self->deadline_ != TimePoint::max() 
+            && self->deadline_ < std::chrono::steady_clock::now()
+        ) {
+            self->chain_.clear();
+            if (auto onExpire = std::move(self->onExpire_); onExpire) {
+                self->onExpire_ = nullptr;
+                std::invoke(onExpire);
+            }
+            return;
+        }
+
         auto ctx { std::move(self->chain_.front()) };
         self->chain_.pop_front();
-        std::invoke(ctx.task, std::move(ctx.cb)); 
+        // `hook` will be executed in `task` instead of original callback `cb`.
+        // Only the running task refers to the chain: no cycle 
+        // through the tasks which haven't started
+        auto hook = [self, cb = std::move(ctx.cb)]() {
+            if (cb) cb();
+            if (!self->chain_.empty()) self->Execute();
+        };
+        std::invoke(ctx.task, std::move(hook)); 
+    });
+}
+
+void Chain::Cancel() {
+    boost::asio::post(strand_, [self = shared_from_this()]() {
+        self->chain_.clear();
+        self->onExpire_ = nullptr;
     });
 }
\ No newline at end of file
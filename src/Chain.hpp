@@ -2,6 +2,7 @@
 #include <list>
 #include <memory>
 #include <functional>
+#include <chrono>
 
 #include <boost/asio.hpp>
 
@@ -11,22 +12,41 @@
  * than the current's task callback is called.
  * 
  * Chain stores all tasks + callbacks
- * Chain is not observed by more than one thread at once
+ * Chain is not observed by more than one thread at once:
+ * tasks are started within the strand of the service which owns the chain
+ *
+ * Chain may have a deadline: tasks which haven't started 
+ * before the deadline are dropped.
+ *
+ * Chain is kept alive only by the callback of the running task,
+ * so the chain whose task never completes (e.g., failed request)
+ * is destroyed with that task's callback.
  */
 class Chain : public std::enable_shared_from_this<Chain> {
 public:
     using Callback = std::function<void()>;
     using Task = std::function<void(Callback)>;
+    using TimePoint = std::chrono::steady_clock::time_point;
+    using Strand = boost::asio::io_context::strand;
 
-    Chain(std::shared_ptr<boost::asio::io_context> context);
+    Chain(Strand strand);
 
     // NOTE: Here `cb` MUST NOT be async (must not invoke async work)
     Chain& Add(Callback cb);
 
     Chain& Add(Task task, Callback cb = {});
 
+    // Drop the rest of the chain if the next task is about 
+    // to start after the `deadline`. `onExpire` is invoked instead.
+    // NOTE: Here `onExpire` MUST NOT be async (must not invoke async work)
+    Chain& SetDeadline(TimePoint deadline, Callback onExpire = {});
+
     void Execute();
 
+    // Drop the tasks which haven't started yet, `onExpire` isn't invoked.
+    // Thread-safe: applied through `strand_`
+    void Cancel();
+
 private:
 
     struct Bind {
@@ -36,11 +56,14 @@ private:
         {}
 
         Task task;
-        // callback is being passed to task as parameter via std::move
-        // and will be destroyed with task. 
+        // callback is wrapped into the hook which continues the chain
+        // when the task is started and will be destroyed with task. 
         Callback cb;
     };
 
-    std::shared_ptr<boost::asio::io_context> context_;
+    Strand strand_;
     std::list<Bind> chain_;
+
+    TimePoint deadline_ { TimePoint::max() };
+    Callback onExpire_;
 };
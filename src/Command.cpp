@@ -7,9 +7,23 @@
 #include "Console.hpp"
 
 #include <algorithm>
+#include <charconv>
+#include <cstring>
 
 namespace {
 
+// Pool of recycled `RawCommand` buffers
+using Pool = CcQueue<std::string, cst::kQueueCapacity>;
+
+// don't keep too big buffers in the pool
+constexpr size_t kMaxPooledCapacity { 4096 };
+
+Pool& GetPool() {
+    // without sentinel: never blocks
+    static Pool pool { false };
+    return pool;
+}
+
 std::string Find(const command::Args& args, std::string_view key) {
     auto it = std::find_if(args.cbegin(), args.cend()
         , [key](const command::ParamView& param) {
@@ -75,6 +89,148 @@ namespace command {
         return result;
     }
 
+    RawCommand::RawCommand(std::string_view command, const Args& params) 
+        : enqueued_ { Clock::now() }
+    {
+        Pack(command, params.begin(), params.end());
+    }
+
+    RawCommand::RawCommand(std::string_view command
+        , std::initializer_list<ParamView> params
+    ) 
+        : enqueued_ { Clock::now() }
+    {
+        Pack(command, params.begin(), params.end());
+    }
+
+    RawCommand::RawCommand(RawCommand&& other) noexcept
+        : storage_ { std::move(other.storage_) }
+        , count_ { other.count_ }
+        , enqueued_ { other.enqueued_ }
+        , deadline_ { other.deadline_ }
+    {
+        other.count_ = 0;
+    }
+
+    RawCommand& RawCommand::operator=(RawCommand&& other) noexcept {
+        if (this != &other) {
+            Recycle();
+            storage_ = std::move(other.storage_);
+            count_ = other.count_;
+            enqueued_ = other.enqueued_;
+            deadline_ = other.deadline_;
+            other.count_ = 0;
+        }
+        return *this;
+    }
+
+    RawCommand::~RawCommand() {
+        Recycle();
+    }
+
+    std::string_view RawCommand::GetCommand() const noexcept {
+        if (storage_.empty()) {
+            return {};
+        }
+        Length length;
+        std::memcpy(&length, storage_.data(), sizeof(length));
+        return { storage_.data() + sizeof(length), length };
+    }
+
+    void RawCommand::GetParams(Args& out) const {
+        if (storage_.empty()) {
+            return;
+        }
+        out.reserve(out.size() + count_);
+        const auto next = [this](size_t& offset) {
+            Length length;
+            std::memcpy(&length, storage_.data() + offset, sizeof(length));
+            std::string_view text { storage_.data() + offset + sizeof(length), length };
+            offset += sizeof(length) + length;
+            return text;
+        };
+        size_t offset { 0 };
+        // skip command
+        next(offset);
+        for (size_t i = 0; i < count_; i++) {
+            auto key = next(offset);
+            auto value = next(offset);
+            out.push_back(ParamView{ key, value });
+        }
+    }
+
+    template<typename It>
+    void RawCommand::Pack(std::string_view command, It first, It last) {
+        size_t bytes { sizeof(Length) + command.size() };
+        for (auto it = first; it != last; ++it) {
+            bytes += 2 * sizeof(Length) + it->key_.size() + it->value_.size();
+        }
+
+        if (auto recycled = GetPool().TryPop(); recycled) {
+            storage_ = std::move(*recycled);
+            storage_.clear();
+        }
+        storage_.reserve(bytes);
+
+        Append(command);
+        for (auto it = first; it != last; ++it) {
+            Append(it->key_);
+            Append(it->value_);
+            count_++;
+        }
+    }
+
+    void RawCommand::Append(std::string_view text) {
+        const auto length = static_cast<Length>(text.size());
+        assert(length == text.size() && "Too long text");
+        char prefix[sizeof(Length)];
+        std::memcpy(prefix, &length, sizeof(length));
+        storage_.append(prefix, sizeof(prefix));
+        storage_.append(text.data(), text.size());
+    }
+
+    void RawCommand::Recycle() noexcept {
+        // don't pool empty (possibly moved-from) and huge buffers
+        if (storage_.capacity() > std::string{}.capacity()
+            && storage_.capacity() <= kMaxPooledCapacity
+        ) {
+            storage_.clear();
+            // buffer is just freed if the pool is full
+            (void) GetPool().TryPush(std::move(storage_));
+        }
+        storage_.clear();
+        count_ = 0;
+    }
+
+    std::string_view WriteDeadline(TimePoint deadline, DeadlineBuffer& buffer) noexcept {
+        const auto ticks = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline.time_since_epoch()).count();
+        const auto [end, ec] = std::to_chars(buffer.data()
+            , buffer.data() + buffer.size()
+            , ticks);
+        assert(ec == std::errc() && "Buffer is too small");
+        return { buffer.data(), static_cast<size_t>(end - buffer.data()) };
+    }
+
+    TimePoint ReadDeadline(const Args& args) noexcept {
+        auto it = std::find_if(args.cbegin(), args.cend()
+            , [](const command::ParamView& param) {
+                return param.key_ == kDeadlineKey;
+            });
+        if (it == args.cend()) {
+            return kNoDeadline;
+        }
+        std::chrono::milliseconds::rep ticks { 0 };
+        const auto& value = it->value_;
+        const auto [end, ec] = std::from_chars(value.data()
+            , value.data() + value.size()
+            , ticks);
+        if (ec != std::errc() || end != value.data() + value.size()) {
+            return kNoDeadline;
+        }
+        return TimePoint { std::chrono::milliseconds { ticks } };
+    }
+
     Alias Alias::Create(const service::Console&, 
         const Args& args
     ) {
@@ -95,7 +251,7 @@ namespace command {
         auto channel { ::Find(args, "channel") };
         auto user { ::Find(args, "user") };
 
-        return { std::move(channel), std::move(user) };
+        return { std::move(channel), std::move(user), ReadDeadline(args) };
     }
 
     RealmStatus RealmStatus::Create(const service::Twitch&,
@@ -110,7 +266,8 @@ namespace command {
         auto channel { ::Find(args, "channel") };
         auto user { ::Find(args, "user") };
         auto player { ::Find(args, "player") };
-        return { std::move(channel), std::move(user), std::move(player) };
+        return { std::move(channel), std::move(user), std::move(player)
+            , ReadDeadline(args) };
     }
 
     Arena Arena::Create(const service::Twitch&, const Args& args) {
@@ -149,4 +306,4 @@ namespace command {
         return { std::move(channel), std::move(message) };
     }
 
-}
\ No newline at end of file
+}
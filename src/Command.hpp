@@ -1,13 +1,17 @@
 #pragma once
 #include <type_traits>
+#include <array>
 #include <vector>
 #include <string_view>
 #include <sstream>
 #include <string>
 #include <cassert>
+#include <cstdint>
+#include <initializer_list>
+#include <chrono>
 
 #include "Environment.hpp"
-#include "ConcurrentQueue.hpp"
+#include "Scheduler.hpp"
 
 namespace service {
     class Blizzard;
@@ -30,6 +34,28 @@ namespace command {
 
     using Args = std::vector<ParamView>;
 
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    // command without deadline never expires
+    inline constexpr TimePoint kNoDeadline { TimePoint::max() };
+
+    inline bool IsExpired(TimePoint deadline) noexcept {
+        return deadline != kNoDeadline && deadline < Clock::now();
+    }
+
+    // Deadline is passed to the command's `Create` as a parameter
+    // with `kDeadlineKey` key, so it can be cancelled by the executor
+    inline constexpr std::string_view kDeadlineKey { "deadline" };
+
+    using DeadlineBuffer = std::array<char, 24>;
+
+    // Serialize `deadline` to the `buffer`. return view to the `buffer`
+    std::string_view WriteDeadline(TimePoint deadline, DeadlineBuffer& buffer) noexcept;
+
+    // return `kNoDeadline` if there is no valid deadline in `args`
+    TimePoint ReadDeadline(const Args& args) noexcept;
+
     // ExtractArgs line `src` for key-value pairs 
     // 
     // <code>
@@ -43,12 +69,92 @@ namespace command {
     // if you need '-' use quotes
     command::Args ExtractArgs(std::string_view src, char key_delimiter);
 
-    struct RawCommand {
-        std::string command_;
-        std::vector<ParamData> params_;
+    /**
+     * Command which is passed between services through the `Queue`.
+     * 
+     * Command name and all its parameters are packed into one contiguous 
+     * buffer as length-prefixed strings: [name][key 0][value 0]...[key N][value N]
+     * The buffer is taken from the pool of recycled buffers 
+     * and is returned there on destruction, so creation of the command 
+     * doesn't allocate once the pool is warm.
+     */
+    class RawCommand {
+    public:
+        RawCommand() = default;
+
+        RawCommand(std::string_view command, const Args& params);
+
+        RawCommand(std::string_view command, std::initializer_list<ParamView> params);
+
+        RawCommand(const RawCommand&) = delete;
+        RawCommand& operator=(const RawCommand&) = delete;
+
+        RawCommand(RawCommand&& other) noexcept;
+        RawCommand& operator=(RawCommand&& other) noexcept;
+
+        ~RawCommand();
+
+        std::string_view GetCommand() const noexcept;
+
+        size_t GetParamCount() const noexcept {
+            return count_;
+        }
+
+        // Append parameters to `out`. 
+        // Views are valid as long as the command is alive and not modified.
+        void GetParams(Args& out) const;
+
+        // Packed command, i.e. identity of the command and its parameters
+        std::string_view GetStorage() const noexcept {
+            return storage_;
+        }
+
+        TimePoint GetEnqueueTime() const noexcept {
+            return enqueued_;
+        }
+
+        TimePoint GetDeadline() const noexcept {
+            return deadline_;
+        }
+
+        void SetDeadline(TimePoint deadline) noexcept {
+            deadline_ = deadline;
+        }
+
+    private:
+        using Length = std::uint32_t;
+
+        template<typename It>
+        void Pack(std::string_view command, It first, It last);
+
+        void Append(std::string_view text);
+
+        // return the buffer to the pool
+        void Recycle() noexcept;
+
+        std::string storage_;
+        size_t count_ { 0 };
+        // time of the command creation
+        TimePoint enqueued_ {};
+        // the answer is useless after this moment
+        TimePoint deadline_ { kNoDeadline };
+    };
+
+    // Priority classes of the command queue.
+    // Workers drain the class with the lower value first.
+    enum Priority : std::size_t {
+        kInteractive,   // replies to the users, e.g. `chat`
+        kFetch,         // user-initiated requests, e.g. `arena`, `realm-status`
+        kPriorityCount
+    };
+
+    // max number of queued commands per priority class
+    inline constexpr std::array<std::size_t, kPriorityCount> kPriorityCapacity {
+        cst::kQueueCapacity, 
+        cst::kQueueCapacity / 2
     };
 
-    using Queue = CcQueue<command::RawCommand, cst::kQueueCapacity>;
+    using Queue = Scheduler<command::RawCommand, cst::kQueueCapacity, kPriorityCount>;
 
     struct Alias {
         static constexpr std::string_view kIdentity = "alias";
@@ -77,6 +183,7 @@ namespace command {
         std::string channel_;
         // initiator of the command
         std::string user_;
+        TimePoint deadline_ { kNoDeadline };
 
         static RealmStatus Create(const service::Blizzard& ctx, const Args& params);
         static RealmStatus Create(const service::Twitch& ctx, const Args& params);
@@ -88,13 +195,14 @@ namespace command {
         std::string channel_;
         std::string user_;
         std::string player_;
+        TimePoint deadline_ { kNoDeadline };
 
         static Arena Create(const service::Blizzard& ctx, const Args& params);
         static Arena Create(const service::Twitch& ctx, const Args& params);
     };
 
     struct AccessToken {
-        static constexpr std::string_view kIdentity = "token";
+        static constexpr std::string_view kIdentity = "blizzard-token";
 
         static AccessToken Create(const service::Blizzard&, const Args&) {
             return {};
@@ -109,6 +217,24 @@ namespace command {
         }
     };
 
+    // print queue statistics and metrics
+    struct QueueStats {
+        static constexpr std::string_view kIdentity = "queue-stats";
+
+        static QueueStats Create(const service::Console&, const Args&) {
+            return {};
+        }
+    };
+
+    // print latency and traffic of the connections per host
+    struct ConnectionStats {
+        static constexpr std::string_view kIdentity = "connection-stats";
+
+        static ConnectionStats Create(const service::Console&, const Args&) {
+            return {};
+        }
+    };
+
     struct Help {
         static constexpr std::string_view kIdentity = "help";
 
@@ -120,14 +246,6 @@ namespace command {
         }
     };
     
-    struct Pong {
-        static constexpr std::string_view kIdentity = "pong";
-
-        static Pong Create(const service::Twitch&, const Args&) {
-            return {};
-        }
-    };
-
     struct Ping {
         static constexpr std::string_view kIdentity = "ping";
 
@@ -197,6 +315,8 @@ namespace command {
                 std::is_same_v<T, Shutdown>
                 || std::is_same_v<T, Help>
                 || std::is_same_v<T, Alias>
+                || std::is_same_v<T, QueueStats>
+                || std::is_same_v<T, ConnectionStats>
             };
         };
 
@@ -208,7 +328,6 @@ namespace command {
                 || std::is_same_v<T, Login>
                 || std::is_same_v<T, Join>
                 || std::is_same_v<T, Leave>
-                || std::is_same_v<T, Pong>
                 || std::is_same_v<T, Ping>
                 || std::is_same_v<T, RealmStatus> // pass it to the next layer (App)
                 || std::is_same_v<T, Arena> // pass it to the next layer (App)
@@ -238,4 +357,15 @@ namespace command {
         ex.Execute(std::forward<Command>(cmd));
     }
 
-}
\ No newline at end of file
+}
+
+// used by `Queue` to coalesce duplicated commands:
+// the packed name and parameters identify the command
+template<>
+struct CoalesceKey<command::RawCommand> {
+    using type = std::string;
+
+    static type Make(const command::RawCommand& cmd) {
+        return type { cmd.GetStorage() };
+    }
+};
@@ -2,57 +2,78 @@
 #pragma once
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 #include <array>
+#include <thread>
 #include <cassert>
+#include <cstdint>
 #include <optional>
 #include <type_traits>
 
-
+/**
+ * Bounded lock-free multi-producer/multi-consumer queue.
+ *
+ * Every slot of the ring keeps a sequence number which tells
+ * whether the slot is ready to be written by the producer
+ * or read by the consumer for the current lap:
+ *  - `sequence == position`            slot is free for the producer
+ *  - `sequence == position + 1`        slot keeps a value for the consumer
+ *  - `sequence == position + Capacity` slot was consumed and free for the next lap
+ * Producers and consumers claim positions via CAS on `back_` and `front_`
+ * so they never touch a mutex on the hot path.
+ *
+ * Mutex and condition variable are used only to park consumers
+ * when the queue is empty (and has sentinel). Producers touch them
+ * only if there is at least one parked consumer.
+ */
 template<typename T, std::size_t Capacity>
 class CcQueue {
 public:
     static_assert(std::is_move_constructible_v<T>, "T must be move-constructible");
     static_assert(std::is_move_assignable_v<T>, "T must be move-assignable");
+    static_assert(std::is_default_constructible_v<T>, "T must be default-constructible");
+    static_assert(Capacity > 0, "Capacity can't be zero");
 
     static constexpr std::size_t kCapacity { Capacity };
 
     using element = T;
-    using container = std::array<element, kCapacity>;
 
-    CcQueue(bool sentinel = true) 
+    CcQueue(bool sentinel = true)
         : front_ { 0 }
         , back_ { 0 }
-        , size_ { 0 }
         , sentinel_ { sentinel }
     {
-        assert(front_ == back_);
+        for (std::size_t i = 0; i < kCapacity; i++) {
+            container_[i].sequence.store(i, std::memory_order_relaxed);
+        }
     }
 
+    CcQueue(const CcQueue&) = delete;
+    CcQueue& operator=(const CcQueue&) = delete;
+    CcQueue(CcQueue&&) = delete;
+    CcQueue& operator=(CcQueue&&) = delete;
+
     // return true if value was pushed successfully (queue is not full)
     // otherwise return false on failure and doesn't block
-    [[nodiscard]] bool TryPush(element cmd) {
-        bool isPushed = false;
-        if (std::unique_lock<std::mutex> lock { mutex_ }; 
-            !IsFull()
-        ) {
-            PushBack(std::move(cmd));
-            lock.unlock();
-            isPushed = true;
-            // notify consumers
-            notifier_.notify_one();
+    // Note: `cmd` is moved from only on success
+    [[nodiscard]] bool TryPush(element&& cmd) {
+        if (!Enqueue(cmd)) {
+            return false;
         }
-        return isPushed;
+        // notify consumers
+        Notify();
+        return true;
     }
 
     // return front element if queue isn't empty
     // otherwise blocks
     // Note: it ignores sentinel so you can't stop consumer thread
     [[nodiscard]] element Pop() {
-        std::unique_lock<std::mutex> lock { mutex_ };  
-        notifier_.wait(lock, [this]() { 
-            return !IsEmpty(); 
-        });
-        return PopFront();
+        element value;
+        while (!Dequeue(value)) {
+            Park([this]() { return !IsEmpty(); });
+        }
+        return value;
     }
 
     // return front element if queue is not empty
@@ -60,57 +81,162 @@ public:
     // otherwise (queue is empty and has sentinel) block
     [[nodiscard]] std::optional<element> TryPop() {
         std::optional<element> result{};
-
-        std::unique_lock<std::mutex> lock { mutex_ };  
-        notifier_.wait(lock, [this]() { 
-            // wait (block) while the <empty> queue has <sentinel>
-            return !(IsEmpty() && sentinel_); 
-        });
-        if (!IsEmpty()) {
-            result.emplace(PopFront());
+        element value;
+        while (!Dequeue(value)) {
+            if (!sentinel_.load()) {
+                // the last chance: producer may have pushed value
+                // right before the sentinel was disabled
+                if (Dequeue(value)) break;
+                return result;
+            }
+            Park([this]() {
+                // wait (block) while the <empty> queue has <sentinel>
+                return !(IsEmpty() && sentinel_.load());
+            });
         }
-        lock.unlock();
+        result.emplace(std::move(value));
         return result;
     }
 
+    // Move up to `max` front elements to `out`.
+    // Blocks the same way as `TryPop` until at least one element is available,
+    // then takes whatever is already in the queue without blocking.
+    // return number of popped elements;
+    // zero means that queue is empty and doesn't have sentinel
+    template<typename OutputIt>
+    [[nodiscard]] std::size_t TryPopBulk(OutputIt out, std::size_t max) {
+        if (max == 0) {
+            return 0;
+        }
+        auto first { TryPop() };
+        if (!first) {
+            return 0;
+        }
+        *out = std::move(*first);
+        ++out;
+
+        std::size_t popped { 1 };
+        element value;
+        while (popped < max && Dequeue(value)) {
+            *out = std::move(value);
+            ++out;
+            ++popped;
+        }
+        return popped;
+    }
+
     void DisableSentinel() {
         {
             std::unique_lock lock { mutex_ };
-            sentinel_ = false;
+            sentinel_.store(false);
         }
         notifier_.notify_all();
     }
 
 private:
 
-    void PushBack(element&& value) noexcept {
-        assert(!IsFull());
-        container_[back_] = std::move(value);
-        back_ = (back_ + 1) % kCapacity;
-        size_++;
+    struct alignas(64) Cell {
+        std::atomic<std::size_t> sequence { 0 };
+        element value {};
+    };
+
+    using container = std::array<Cell, kCapacity>;
+
+    // Claim the next position for write. Doesn't block.
+    [[nodiscard]] bool Enqueue(element& value) {
+        std::size_t position = back_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = container_[position % kCapacity];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(sequence)
+                - static_cast<std::intptr_t>(position);
+            if (diff == 0) {
+                // slot is free for this lap, try to claim it
+                if (back_.compare_exchange_weak(position, position + 1)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+                // `position` was reloaded by failed CAS
+            }
+            else if (diff < 0) {
+                // slot still keeps value from the previous lap: queue is full
+                return false;
+            }
+            else {
+                // other producer has already claimed this position
+                position = back_.load(std::memory_order_relaxed);
+            }
+        }
     }
 
-    [[nodiscard]] element PopFront() {
-        assert(!IsEmpty());
-        element value = std::move(container_[front_]);
-        front_ = (front_ + 1) % kCapacity;
-        size_--;
-        return value;
+    // Claim the next position for read. Doesn't block.
+    [[nodiscard]] bool Dequeue(element& value) {
+        std::size_t position = front_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = container_[position % kCapacity];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(sequence)
+                - static_cast<std::intptr_t>(position + 1);
+            if (diff == 0) {
+                if (front_.compare_exchange_weak(position, position + 1)) {
+                    value = std::move(cell.value);
+                    cell.sequence.store(position + kCapacity, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                // slot isn't published yet: queue is empty
+                return false;
+            }
+            else {
+                position = front_.load(std::memory_order_relaxed);
+            }
+        }
     }
 
-    [[nodiscard]] bool IsEmpty() const noexcept {
-        return size_ == 0;
+    // Block consumer until the `ready` predicate is satisfied
+    template<typename Predicate>
+    void Park(Predicate&& ready) {
+        std::unique_lock<std::mutex> lock { mutex_ };
+        // seq_cst increment pairs with the seq_cst `back_` update
+        // and `waiters_` load in `Notify` (Dekker-like handshake):
+        // either producer sees the waiter or consumer sees the value.
+        waiters_.fetch_add(1);
+        if (!ready()) {
+            notifier_.wait(lock, ready);
+        }
+        waiters_.fetch_sub(1);
+        if (!IsEmpty()) {
+            // The position is claimed but the value may be still not published.
+            // Let the producer finish its write.
+            lock.unlock();
+            std::this_thread::yield();
+        }
     }
 
-    [[nodiscard]] bool IsFull() const noexcept {
-        return size_ == kCapacity;
+    void Notify() {
+        if (waiters_.load() == 0) {
+            return;
+        }
+        {
+            // the consumer either hasn't checked the predicate yet
+            // or is already waiting, so the notification won't be lost
+            std::lock_guard<std::mutex> lock { mutex_ };
+        }
+        notifier_.notify_one();
+    }
+
+    [[nodiscard]] bool IsEmpty() const noexcept {
+        return front_.load() >= back_.load();
     }
 
+    container container_;
+    alignas(64) std::atomic<std::size_t> front_ { 0 };
+    alignas(64) std::atomic<std::size_t> back_ { 0 };
+    alignas(64) std::atomic<std::size_t> waiters_ { 0 };
+    std::atomic<bool> sentinel_ { false };
+
     std::mutex mutex_;
     std::condition_variable notifier_;
-    container container_;
-    std::size_t front_ { 0 };
-    std::size_t back_ { 0 };
-    std::size_t size_ { 0 };
-    bool sentinel_ { false };
 };
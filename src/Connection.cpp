@@ -1,5 +1,7 @@
 #include "Connection.hpp"
 #include "Utility.hpp"
+#include "SessionCache.hpp"
+#include "DnsCache.hpp"
 
 #include <cassert>
 #include <functional>
@@ -7,6 +9,22 @@
 
 #include <boost/format.hpp>
 
+struct Connection::Race {
+    explicit Race(boost::asio::io_context& context)
+        : timer { context }
+    {}
+
+    std::vector<tcp::endpoint> endpoints;
+    // i-th socket connects to the i-th endpoint
+    std::vector<tcp::socket> sockets;
+    size_t started { 0 };
+    size_t failed { 0 };
+    // either some attempt won or the race was stopped
+    bool finished { false };
+    // staggers the attempts
+    boost::asio::deadline_timer timer;
+};
+
 Connection::Connection(SharedIOContext context
     , SharedSSLContext sslContext
     , std::string_view host
@@ -15,7 +33,6 @@ Connection::Connection(SharedIOContext context
 )
     : context_ { context }
     , ssl_ { sslContext }
-    , resolver_ { *context }
     , strand_ { *context }
     , socket_ { std::in_place, *context, *sslContext }
     , timer_ { *context }
@@ -23,6 +40,8 @@ Connection::Connection(SharedIOContext context
     , service_ { service }
     , log_ { std::make_shared<Log>((boost::format("%1%_%2%_%3%.txt") % host % service % id).str().data()) }
     , isWriting_ { false }
+    , flushTimer_ { *context }
+    , phaseTimer_ { *context }
 {
 }
 
@@ -32,12 +51,20 @@ Connection::~Connection() {
 }
 
 void Connection::Close() {
+    StopRace();
+    FinishPhase();
     boost::system::error_code error;
     timer_.cancel(error);
     if (error) {
         LOG_ERROR(*log_, "timer cancel: ", error.message());
         error.clear();
     }
+    flushTimer_.cancel(error);
+    isFlushArmed_ = false;
+    if (error) {
+        LOG_ERROR(*log_, "flush timer cancel: ", error.message());
+        error.clear();
+    }
 
     assert(socket_.has_value() && "optional can't be empty"
         "(maybe there is data race where emplace is being called)"
@@ -69,25 +96,65 @@ void Connection::ScheduleShutdown() {
     });
 }
 
+void Connection::ResetCallbacks(std::function<void()> onReset) {
+    boost::asio::post(strand_, [self = shared_from_this()
+        , onReset = std::move(onReset)
+    ]() {
+        self->onConnectSuccess_ = nullptr;
+        self->onReadSuccess_ = nullptr;
+        self->onFailure_ = nullptr;
+        if (onReset) {
+            std::invoke(onReset);
+        }
+    });
+}
+
+bool Connection::IsAlive() {
+    assert(socket_.has_value());
+    auto&& socket = socket_->next_layer();
+    if (!socket.is_open()) {
+        return false;
+    }
+    // Idle peer sends nothing, so any readable data means that
+    // the server closed the connection (EOF or TLS close_notify) 
+    // or broke the protocol.
+    boost::system::error_code error;
+    char byte;
+    socket.non_blocking(true, error);
+    const auto peeked = socket.receive(boost::asio::buffer(&byte, 1)
+        , tcp::socket::message_peek, error);
+    const bool alive { peeked == 0 && error == boost::asio::error::would_block };
+    socket.non_blocking(false, error);
+    return alive;
+}
+
 void Connection::Connect(std::function<void()> onConnect) { 
     if (onConnect) {
         onConnectSuccess_ = std::move(onConnect);
     }
-    resolver_.async_resolve(host_
+    StartPhase(kResolve);
+    // cached endpoints are returned without waiting for the resolver
+    DnsCache::Resolve(*context_
+        , host_
         , service_
-        , boost::asio::bind_executor(strand_
-            , std::bind(&Connection::OnResolve
-                , shared_from_this()
-                , std::placeholders::_1
-                , std::placeholders::_2
-            )
-        )
+        , [self = shared_from_this()](const boost::system::error_code& error
+            , tcp::resolver::results_type results
+        ) {
+            boost::asio::post(self->strand_, [self, error, results = std::move(results)]() {
+                self->OnResolve(error, std::move(results));
+            });
+        }
     );
 }
 
 void Connection::OnResolve(const boost::system::error_code& error
     , tcp::resolver::results_type results
 ) {
+    if (phase_ != kResolve) {
+        // the resolve deadline has expired, reconnection is in progress
+        LOG_INFO(*log_, "ignore late resolution");
+        return;
+    }
     if (error) {
         LOG_ERROR(*log_, error.message());
         if (error != boost::asio::error::operation_aborted) {
@@ -95,6 +162,7 @@ void Connection::OnResolve(const boost::system::error_code& error
         }
     }
     else {
+        RecordPhase();
         // configure socket
         // 1. setup verification process settings
         socket_->set_verify_mode(ssl::verify_peer);
@@ -110,19 +178,120 @@ void Connection::OnResolve(const boost::system::error_code& error
             throw boost::system::system_error{ ec };
         }
 
-        boost::asio::async_connect(socket_->lowest_layer()
-            , results
-            , boost::asio::bind_executor(strand_
-                , std::bind(&Connection::OnConnect
-                    , shared_from_this()
-                    , std::placeholders::_1
-                    , std::placeholders::_2
-                )
-            )
-        );
+        // 3. offer the session of the previous connection to the host
+        // (reconnection uses it as well) to skip the full handshake
+        if (SessionCache::Resume(socket_->native_handle(), host_)) {
+            LOG_INFO(*log_, "try to resume TLS session");
+        }
+
+        // 4. race the endpoints interleaving the address families
+        // starting with the preferred one (the first returned by resolver)
+        StopRace();
+        race_ = std::make_shared<Race>(*context_);
+        std::vector<tcp::endpoint> preferred, other;
+        for (const auto& entry: results) {
+            const auto& endpoint = entry.endpoint();
+            if (preferred.empty() || endpoint.protocol() == preferred.front().protocol()) {
+                preferred.push_back(endpoint);
+            }
+            else {
+                other.push_back(endpoint);
+            }
+        }
+        for (size_t i = 0; i < std::max(preferred.size(), other.size()); i++) {
+            if (i < preferred.size()) race_->endpoints.push_back(preferred[i]);
+            if (i < other.size()) race_->endpoints.push_back(other[i]);
+        }
+        if (race_->endpoints.empty()) {
+            race_.reset();
+            OnConnect(boost::asio::error::host_not_found, {});
+            return;
+        }
+        StartPhase(kConnect);
+        // sockets aren't moved while attempts are in progress
+        race_->sockets.reserve(race_->endpoints.size());
+        for (size_t i = 0; i < race_->endpoints.size(); i++) {
+            race_->sockets.emplace_back(*context_);
+        }
+        StartAttempt(race_);
     }
 }
 
+void Connection::StartAttempt(const std::shared_ptr<Race>& race) {
+    assert(race->started < race->endpoints.size());
+    const size_t index { race->started++ };
+    LOG_INFO(*log_, "connect attempt #", index, " to ", race->endpoints[index]);
+    race->sockets[index].async_connect(race->endpoints[index]
+        , boost::asio::bind_executor(strand_
+            , [self = shared_from_this(), race, index](const boost::system::error_code& error) {
+                self->OnAttempt(race, index, error);
+            }
+        )
+    );
+    if (race->started < race->endpoints.size()) {
+        // don't wait for the slow (or blackholed) endpoint too long
+        race->timer.expires_from_now(boost::posix_time::milliseconds{ kAttemptDelay });
+        race->timer.async_wait(boost::asio::bind_executor(strand_
+            , [self = shared_from_this(), race](const boost::system::error_code& error) {
+                if (!error && !race->finished && race->started < race->endpoints.size()) {
+                    self->StartAttempt(race);
+                }
+            }
+        ));
+    }
+}
+
+void Connection::OnAttempt(const std::shared_ptr<Race>& race
+    , size_t index
+    , const boost::system::error_code& error
+) {
+    if (race->finished) {
+        // lost the race or the race was stopped
+        return;
+    }
+    if (!error) {
+        race->finished = true;
+        boost::system::error_code ignored;
+        race->timer.cancel(ignored);
+        for (size_t i = 0; i < race->sockets.size(); i++) {
+            if (i != index) race->sockets[i].close(ignored);
+        }
+        socket_->next_layer() = std::move(race->sockets[index]);
+        if (race_ == race) {
+            race_.reset();
+        }
+        OnConnect(error, race->endpoints[index]);
+        return;
+    }
+
+    LOG_WARN(*log_, "connect attempt #", index, " failed: ", error.message());
+    if (++race->failed == race->endpoints.size()) {
+        // all endpoints failed
+        race->finished = true;
+        if (race_ == race) {
+            race_.reset();
+        }
+        OnConnect(error, race->endpoints[index]);
+    }
+    else if (race->started < race->endpoints.size()) {
+        // start the next attempt at once
+        StartAttempt(race);
+    }
+}
+
+void Connection::StopRace() {
+    if (!race_) {
+        return;
+    }
+    race_->finished = true;
+    boost::system::error_code ignored;
+    race_->timer.cancel(ignored);
+    for (auto& socket: race_->sockets) {
+        socket.close(ignored);
+    }
+    race_.reset();
+}
+
 void Connection::OnConnect(const boost::system::error_code& error
     , const boost::asio::ip::tcp::endpoint& endpoint
 ) {
@@ -134,6 +303,8 @@ void Connection::OnConnect(const boost::system::error_code& error
     } 
     else {
         LOG_INFO(*log_, "connected. Local port: ", endpoint);
+        RecordPhase();
+        StartPhase(kHandshake);
         socket_->async_handshake(boost::asio::ssl::stream_base::client
             , boost::asio::bind_executor(strand_
                 , std::bind(&Connection::OnHandshake
@@ -148,12 +319,17 @@ void Connection::OnConnect(const boost::system::error_code& error
 void Connection::OnHandshake(const boost::system::error_code& error) {
     if (error) {
         LOG_ERROR(*log_, error.message());
+        // don't offer the same session on reconnection
+        SessionCache::Forget(socket_->native_handle(), host_);
         if (error != boost::asio::error::operation_aborted) {
             Reconnect();
         }
     }
     else {
-        LOG_INFO(*log_, "handshake successeded.");
+        LOG_INFO(*log_, "handshake successeded. Session is "
+            , (SSL_session_reused(socket_->native_handle())? "resumed": "new"));
+        RecordPhase();
+        FinishPhase();
         reconnects_ = 0;
         if (onConnectSuccess_) {
             std::invoke(onConnectSuccess_);
@@ -162,6 +338,7 @@ void Connection::OnHandshake(const boost::system::error_code& error) {
 }
 
 void Connection::Reconnect() {
+    metrics_.OnReconnect();
     Close();
     // prepare for reconnection
     socket_.emplace(*context_, *ssl_);
@@ -176,28 +353,189 @@ void Connection::Reconnect() {
     LOG_INFO(*log_, "reconnecting after ", timeout, " seconds ...");
 }
 
-void Connection::ScheduleWrite(std::string text, std::function<void()> onWrite) {
-    auto deferredCallee = [text = std::move(text)
-        , callback = std::move(onWrite)
-        , self = shared_from_this()
-    ]() mutable {
-        self->outbox_.Enque(std::move(text), std::move(callback));
-        if (!self->isWriting_) {
-            self->Write();
+void Connection::Abandon() {
+    Close();
+    if (!isWriting_) {
+        // otherwise the buffer is released by the next write
+        outbox_.Clear();
+    }
+    // invoked before the callbacks are released:
+    // they may be the last owners of the user
+    if (auto onFailure = std::move(onFailure_); onFailure) {
+        onFailure_ = nullptr;
+        std::invoke(onFailure);
+    }
+    onConnectSuccess_ = nullptr;
+    onReadSuccess_ = nullptr;
+}
+
+void Connection::StartPhase(Phase phase, long timeout) {
+    phase_ = phase;
+    phaseStart_ = std::chrono::steady_clock::now();
+    const auto generation { ++phaseGeneration_ };
+    if (!timeout) {
+        boost::system::error_code ignored;
+        phaseTimer_.cancel(ignored);
+        return;
+    }
+    // re-arming cancels the wait of the previous phase
+    phaseTimer_.expires_from_now(boost::posix_time::seconds{ timeout });
+    // weak: the deadline mustn't keep the connection alive
+    phaseTimer_.async_wait(boost::asio::bind_executor(strand_
+        , [weak = weak_from_this(), phase, generation](const boost::system::error_code& error) {
+            if (auto self = weak.lock(); self) {
+                self->OnDeadline(error, phase, generation);
+            }
         }
-    };
-    // [CRITICAL SECTION]
-    // ASSUMED it's thread-safe to `post` completion token through `strand_`
-    // see https://stackoverflow.com/questions/51859895/is-boostasioio-servicepost-atomic/51862417
-    boost::asio::post(strand_, std::move(deferredCallee));
+    ));
+}
+
+void Connection::FinishPhase() {
+    phase_ = kNone;
+    ++phaseGeneration_;
+    boost::system::error_code ignored;
+    phaseTimer_.cancel(ignored);
+}
+
+void Connection::RecordPhase() {
+    // the first byte isn't a phase of its own: see `HttpConnection::OnFirstRead`
+    ConnectionMetrics::Stage stage;
+    switch (phase_) {
+        case kResolve: stage = ConnectionMetrics::kResolve; break;
+        case kConnect: stage = ConnectionMetrics::kConnect; break;
+        case kHandshake: stage = ConnectionMetrics::kHandshake; break;
+        case kHeader: stage = ConnectionMetrics::kHeader; break;
+        case kBody: stage = ConnectionMetrics::kBody; break;
+        default: return;
+    }
+    metrics_.OnStage(stage, std::chrono::steady_clock::now() - phaseStart_);
+}
+
+void Connection::OnDeadline(const boost::system::error_code& error
+    , Phase phase
+    , size_t generation
+) {
+    if (error == boost::asio::error::operation_aborted 
+        || generation != phaseGeneration_
+    ) {
+        // the phase has completed in time
+        return;
+    }
+    LOG_WARN(*log_, kPhaseNames[phase], " deadline expired");
+    switch (phase) {
+        case kResolve: [[fallthrough]];
+        case kConnect: {
+            // nothing is pending on `socket_`: resolution result is ignored
+            // by `OnResolve`, connection attempts are stopped by `Close`
+            Reconnect();
+        } break;
+        default: {
+            // fail the pending operation: its handler sees the socket
+            // is still open and treats it as any other I/O error
+            // of the established connection, see `OnBroken`
+            FinishPhase();
+            boost::system::error_code ignored;
+            socket_->lowest_layer().shutdown(tcp::socket::shutdown_both, ignored);
+        } break;
+    }
+}
+
+void Connection::ScheduleWrite(std::string text
+    , SwitchBuffer::Callback onWrite
+    , SwitchBuffer::Priority priority
+) {
+    if (writeInbox_.Push({ std::move(text), std::move(onWrite), priority })) {
+        // the inbox was empty so no drain is pending yet:
+        // the following messages of the burst ride on this one
+        boost::asio::post(strand_, std::bind(&Connection::DrainWrites, shared_from_this()));
+    }
+}
+
+void Connection::DrainWrites() {
+    writeInbox_.Drain([this](Outgoing& message) {
+        using Status = SwitchBuffer::Status;
+        switch (outbox_.Enque(message.text, std::move(message.onWrite), message.priority)) {
+            case Status::kDropped: {
+                LOG_WARN(*log_, "outbox is full, drop: ", utils::Trim(message.text));
+            } break;
+            case Status::kDisplaced: {
+                LOG_WARN(*log_, "outbox is full, drop the oldest messages of priority ", message.priority);
+            } break;
+            default: break;
+        }
+    });
+    if (!isWriting_ && outbox_.GetQueueSize()) {
+        WriteOrDefer();
+    }
+}
+
+void Connection::SetCoalescing(Coalescing coalescing) {
+    // weak: settings alone mustn't extend the connection's lifetime
+    boost::asio::post(strand_, [coalescing, weak = weak_from_this()]() {
+        if (auto self = weak.lock(); self) {
+            self->coalescing_ = coalescing;
+        }
+    });
+}
+
+void Connection::QueueWrite(std::string_view text, SwitchBuffer::Priority priority) {
+    if (outbox_.Enque(text, {}, priority) == SwitchBuffer::Status::kDropped) {
+        LOG_WARN(*log_, "outbox is full, drop: ", utils::Trim(text));
+    }
+    else if (!isWriting_) {
+        WriteOrDefer();
+    }
+}
+
+void Connection::SetOutboxLimits(SwitchBuffer::Priority priority, SwitchBuffer::Limits limits) {
+    boost::asio::post(strand_, [priority, limits, weak = weak_from_this()]() {
+        if (auto self = weak.lock(); self) {
+            self->outbox_.SetLimits(priority, limits);
+        }
+    });
+}
+
+void Connection::WriteOrDefer() {
+    assert(!isWriting_);
+    if (!coalescing_.maxDelay 
+        || outbox_.GetQueueBytes() >= coalescing_.threshold
+        // control messages don't wait
+        || outbox_.GetQueueSize(SwitchBuffer::kControl)
+    ) {
+        Write();
+    }
+    else if (!isFlushArmed_) {
+        // the first message of the burst starts the window
+        isFlushArmed_ = true;
+        flushTimer_.expires_from_now(boost::posix_time::milliseconds{ coalescing_.maxDelay });
+        flushTimer_.async_wait(boost::asio::bind_executor(strand_
+            , std::bind(&Connection::OnFlush, shared_from_this(), std::placeholders::_1)
+        ));
+    }
+}
+
+void Connection::OnFlush(const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted) {
+        return;
+    }
+    isFlushArmed_ = false;
+    // the data may have been already sent because of the threshold
+    if (!isWriting_ && outbox_.GetQueueSize()) {
+        Write();
+    }
 }
 
 void Connection::Write() {
+    if (isFlushArmed_) {
+        boost::system::error_code ignored;
+        flushTimer_.cancel(ignored);
+        isFlushArmed_ = false;
+    }
     // add all text that is queued for write operation to active buffer
     outbox_.SwapBuffers();
     isWriting_ = true;
     boost::asio::async_write(*socket_,
-        outbox_.GetBufferSequence(),
+        outbox_.GetBuffer(),
         boost::asio::bind_executor(strand_,
             std::bind(&Connection::OnWrite,
                 shared_from_this(),
@@ -216,23 +554,19 @@ void Connection::OnWrite(const boost::system::error_code& error, size_t bytes) {
         assert(socket_);
         if (auto&& ll = socket_->lowest_layer(); ll.is_open()) {
             // confirm that socket is open to prevent reconnection after shutdown
-            Reconnect();
+            OnBroken();
         }
     }
     else {
-        const auto& sequence = outbox_.GetBufferSequence();
+        metrics_.OnWrite(bytes, outbox_.GetMessageCount());
         // dump data we're sending
         // TODO: escape special characters
-        for (size_t i = 0; i < sequence.size(); i++) {
-            const auto buf = sequence[i];
-            std::string_view dump { static_cast<const char*>(buf.data()), buf.size() };
-            LOG_INFO(*log_, i, "-th sent ", bytes, " bytes: ", utils::Trim(dump));
+        for (size_t i = 0; i < outbox_.GetMessageCount(); i++) {
+            LOG_INFO(*log_, i, "-th sent ", bytes, " bytes: ", utils::Trim(outbox_.GetMessage(i)));
         }
         // as we successfully send all data to remote peer
         // we can now invoke all callbacks which corresponds to these data
-        for (const auto& cb: outbox_.GetCallbackSequence()) {
-            std::invoke(cb);
-        }
+        outbox_.InvokeCallbacks();
         if (outbox_.GetQueueSize()) {
             // there are a few messages scheduled to be sent
             LOG_INFO(*log_, "queued messages: ", outbox_.GetQueueSize());
@@ -252,7 +586,7 @@ void Connection::OnTimeout(const boost::system::error_code& error) {
     }
     else if (reconnects_ > kReconnectLimit) {
         LOG_WARN(*log_, "reached reconnection limit");
-        Close();
+        Abandon();
     }
     else {
         LOG_INFO(*log_, "start connection");
@@ -268,9 +602,36 @@ void HttpConnection::Read(std::function<void()> onSuccess) {
 
 void HttpConnection::ReadHeader() {
     body_.clear();
-    chunk_.Reset();
+    decoder_.Reset();
     inbox_.consume(inbox_.size());
+    StartPhase(kHeader);
     
+    // a separate first read: its completion is the time to first byte
+    socket_->async_read_some(inbox_.prepare(kFirstReadSize)
+        , boost::asio::bind_executor(strand_
+            , std::bind(&HttpConnection::OnFirstRead
+                , utils::SharedFrom<HttpConnection>(shared_from_this())
+                , std::placeholders::_1
+                , std::placeholders::_2
+            )
+        )
+    );
+}
+
+void HttpConnection::OnFirstRead(const boost::system::error_code& error, size_t bytes) {
+    if (error) {
+        LOG_ERROR(*log_, error.message());
+        assert(socket_);
+        if (auto&& ll = socket_->lowest_layer(); ll.is_open()) {
+            // prevent reconnection after shutdown
+            OnBroken();
+        }
+        return;
+    }
+    inbox_.commit(bytes);
+    metrics_.OnStage(ConnectionMetrics::kFirstByte
+        , std::chrono::steady_clock::now() - phaseStart_);
+    // completes at once if the whole header has been read already
     boost::asio::async_read_until(*socket_
         , inbox_
         , kHeaderDelimiter
@@ -290,10 +651,12 @@ void HttpConnection::OnHeaderRead(const boost::system::error_code& error, size_t
         assert(socket_);
         if (auto&& ll = socket_->lowest_layer(); ll.is_open()) {
             // prevent reconnection after shutdown
-            Reconnect();
+            OnBroken();
         }
     } 
     else {
+        // the header and whatever has been read after it
+        metrics_.OnRead(inbox_.size());
         { // extract header
             const auto data { inbox_.data() };
             const std::string header {
@@ -310,21 +673,22 @@ void HttpConnection::OnHeaderRead(const boost::system::error_code& error, size_t
             , header_.reasonPhrase_);
         assert(header_.bodyKind_ != net::http::BodyContentKind::kUnknown);
         
+        RecordPhase();
+        StartPhase(kBody);
         using net::http::BodyContentKind;
         switch (header_.bodyKind_) {
             case BodyContentKind::kChunkedTransferEncoded: {
                 body_.clear();
-                chunk_.Reset();
+                decoder_.Reset();
                 ReadChunkedBody(); 
             } break;
             case BodyContentKind::kContentLengthSpecified: {
-                if (inbox_.size()) {
-                    body_.assign(
-                        boost::asio::buffers_begin(inbox_.data()), 
-                        boost::asio::buffers_begin(inbox_.data()) + inbox_.size()
-                    );
-                    inbox_.consume(inbox_.size());
-                }
+                // size the body up front and read directly into it
+                body_.resize(static_cast<size_t>(header_.bodyLength_));
+                // part of the body may be already read with the header
+                bodyRead_ = boost::asio::buffer_copy(
+                    boost::asio::buffer(body_), inbox_.data());
+                inbox_.consume(bodyRead_);
                 ReadIntactBody(); 
             } break;
             case BodyContentKind::kUnknown: [[fallthrough]];
@@ -336,15 +700,12 @@ void HttpConnection::OnHeaderRead(const boost::system::error_code& error, size_t
 
 void HttpConnection::ReadIntactBody() {
     assert(header_.bodyKind_ == net::http::BodyContentKind::kContentLengthSpecified);
-    static constexpr size_t kChunkSize = 1024;
-    // size of the content I need to parse from the HTTP response
-    const auto bodyExpectedSize = static_cast<size_t>(header_.bodyLength_);
-    const auto parsedContentSize = body_.size();
-    if (parsedContentSize < bodyExpectedSize) {
-        const auto minChunk = std::min(kChunkSize, bodyExpectedSize - parsedContentSize);
+    assert(body_.size() == header_.bodyLength_);
+    if (bodyRead_ < body_.size()) {
+        // one composed operation reads the rest of the body 
+        // straight into its place: no intermediate buffer
         boost::asio::async_read(*socket_
-            , inbox_
-            , boost::asio::transfer_exactly(minChunk)
+            , boost::asio::buffer(body_.data() + bodyRead_, body_.size() - bodyRead_)
             , boost::asio::bind_executor(strand_
                 , std::bind(&HttpConnection::OnReadIntactBody
                     // 1. reader raw ptr is valid as long as connection creator (Service) is alive
@@ -359,6 +720,8 @@ void HttpConnection::ReadIntactBody() {
     else {
         // NOTIFY that we have read body sucessfully
         LOG_INFO(*log_, "body size: ", body_.size());
+        RecordPhase();
+        FinishPhase();
         if (onReadSuccess_) {
             std::invoke(onReadSuccess_);
         }
@@ -371,36 +734,56 @@ void HttpConnection::OnReadIntactBody(const boost::system::error_code& error, si
         assert(socket_);
         if (auto&& ll = socket_->lowest_layer(); ll.is_open()) {
             // prevent reconnection after shutdown
-            Reconnect();
+            OnBroken();
         }
     }
     else {
-        auto data = inbox_.data();
-        std::string chunk {
-            boost::asio::buffers_begin(data), 
-            boost::asio::buffers_begin(data) + bytes
-        };
-        inbox_.consume(bytes);
-        body_.append(chunk);
-        // continue to read
+        metrics_.OnRead(bytes);
+        bodyRead_ += bytes;
+        // `async_read` completes when the whole buffer is filled
         ReadIntactBody();
     }
 }
 
 void HttpConnection::ReadChunkedBody() {
     assert(header_.bodyKind_ == net::http::BodyContentKind::kChunkedTransferEncoded);
+    // decode everything that has been already received
+    const auto data = inbox_.data();
+    const std::string_view received { 
+        static_cast<const char*>(data.data()), data.size() 
+    };
+    inbox_.consume(decoder_.Feed(received, body_));
 
-    boost::asio::async_read_until(*socket_
-        , inbox_
-        , kCRLF
-        , boost::asio::bind_executor(strand_
-            , std::bind(&HttpConnection::OnReadChunkedBody
-                , utils::SharedFrom<HttpConnection>(shared_from_this())
-                , std::placeholders::_1 
-                , std::placeholders::_2
-            )
-        )
-    );
+    using Status = net::http::ChunkedDecoder::Status;
+    switch (decoder_.GetStatus()) {
+        case Status::kDone: {
+            LOG_INFO(*log_, "body size: ", body_.size());
+            RecordPhase();
+            FinishPhase();
+            if (onReadSuccess_) {
+                std::invoke(onReadSuccess_);
+            }
+        } break;
+        case Status::kError: {
+            LOG_ERROR(*log_, "malformed chunked body");
+            assert(socket_);
+            if (auto&& ll = socket_->lowest_layer(); ll.is_open()) {
+                OnBroken();
+            }
+        } break;
+        case Status::kNeedMore: {
+            // read whatever is available, the decoder doesn't care about boundaries
+            socket_->async_read_some(inbox_.prepare(kChunkedReadSize)
+                , boost::asio::bind_executor(strand_
+                    , std::bind(&HttpConnection::OnReadChunkedBody
+                        , utils::SharedFrom<HttpConnection>(shared_from_this())
+                        , std::placeholders::_1 
+                        , std::placeholders::_2
+                    )
+                )
+            );
+        } break;
+    }
 }
 
 void HttpConnection::OnReadChunkedBody(const boost::system::error_code& error, size_t bytes) {
@@ -409,36 +792,12 @@ void HttpConnection::OnReadChunkedBody(const boost::system::error_code& error, s
         assert(socket_);
         if (auto&& ll = socket_->lowest_layer(); ll.is_open()) {
             // condition prevents reconnection attempts after shutdown
-            Reconnect();
+            OnBroken();
         }
         return;
     } 
-
-    const auto data = inbox_.data();
-    std::string chunk {
-        boost::asio::buffers_begin(data), 
-        boost::asio::buffers_begin(data) + bytes - kCRLF.size()
-    };
-    inbox_.consume(bytes);
-    if (chunk_.consumed_ & 1) { 
-        // chunk content
-        chunk_.consumed_++;
-        if (!chunk_.size_) {
-            // This is the last part of 0 chunk so notify about that subscribers
-            // Body has been already read
-            if (onReadSuccess_) {
-                std::invoke(onReadSuccess_);
-            }
-            return;
-        };
-        body_.append(chunk);
-    }
-    else { 
-        // chunk size
-        chunk_.size_ = utils::ExtractInteger(chunk, 16);
-        chunk_.consumed_++;
-    }
-    // read next line
+    inbox_.commit(bytes);
+    metrics_.OnRead(bytes);
     ReadChunkedBody();
 }
 
@@ -446,9 +805,15 @@ void IrcConnection::Read(std::function<void()> onSuccess) {
     if (onSuccess) {
         onReadSuccess_ = std::move(onSuccess);
     }
-    boost::asio::async_read_until(*socket_
-        , inbox_
-        , kCRLF
+    if (!isPingArmed_) {
+        // the connection is established by now
+        SchedulePing();
+    }
+    // any message (at least the answer to own PING) is expected in time
+    StartPhase(kIdle, kIdleDeadline);
+    // Twitch often sends many lines in one record so read
+    // whatever is available instead of a line at a time
+    socket_->async_read_some(inbox_.prepare(kReadSize)
         , boost::asio::bind_executor(strand_
             , std::bind(&IrcConnection::OnRead
                 , utils::SharedFrom<IrcConnection>(shared_from_this())
@@ -459,28 +824,150 @@ void IrcConnection::Read(std::function<void()> onSuccess) {
     );
 }
 
+void IrcConnection::SetOnReconnect(std::function<void()> onReconnect) {
+    boost::asio::post(strand_, [weak = utils::WeakFrom<IrcConnection>(shared_from_this())
+        , onReconnect = std::move(onReconnect)
+    ]() mutable {
+        if (auto self = weak.lock(); self) {
+            self->onReconnect_ = std::move(onReconnect);
+        }
+    });
+}
+
+void IrcConnection::Close() {
+    StopPing();
+    Connection::Close();
+}
+
+void IrcConnection::OnBroken() {
+    if (!onReconnect_) {
+        Abandon();
+        return;
+    }
+    // the new session starts from scratch: neither the rest 
+    // of the old stream nor the old session's callbacks are reused
+    inbox_.consume(inbox_.size());
+    messages_.clear();
+    onConnectSuccess_ = onReconnect_;
+    onReadSuccess_ = nullptr;
+    Reconnect();
+}
+
 void IrcConnection::OnRead(const boost::system::error_code& error, size_t bytes) {
     if (error) {
         LOG_ERROR(*log_, error.message());
         assert(socket_);
         if (auto&& ll = socket_->lowest_layer(); ll.is_open()) {
             // prevent reconnection after shutdown
-            Reconnect();
+            OnBroken();
         }
     } 
     else {
-        const auto data { inbox_.data() };
-        std::string buffer {
-            boost::asio::buffers_begin(data), 
-            boost::asio::buffers_begin(data) + bytes - kCRLF.size()
-        };        
-        inbox_.consume(bytes);
-        LOG_INFO(*log_, "buffer: \"", buffer, '\"');
-        message_ = net::irc::ParseMessage(std::string_view { buffer.data(), buffer.size() });
-
-        if (onReadSuccess_) {
+        inbox_.commit(bytes);
+        metrics_.OnRead(bytes);
+        ExtractMessages();
+        // notify once per batch
+        if (!messages_.empty() && onReadSuccess_) {
             std::invoke(onReadSuccess_);
         }
         Read();
     }
-}
\ No newline at end of file
+}
+
+void IrcConnection::ExtractMessages() {
+    const auto data { inbox_.data() };
+    const std::string_view received { 
+        static_cast<const char*>(data.data()), data.size() 
+    };
+    size_t start { 0 };
+    for (auto end = received.find(kCRLF); 
+        end != std::string_view::npos; 
+        end = received.find(kCRLF, start)
+    ) {
+        const auto line { received.substr(start, end - start) };
+        start = end + kCRLF.size();
+        if (line.empty()) {
+            continue;
+        }
+        LOG_INFO(*log_, "buffer: \"", line, '\"');
+        if (!HandleKeepalive(line)) {
+            messages_.push_back(net::irc::ParseMessage(line));
+        }
+    }
+    inbox_.consume(start);
+}
+
+bool IrcConnection::HandleKeepalive(std::string_view line) {
+    // PING has no tags and prefix: "PING :tmi.twitch.tv"
+    if (line.substr(0, kPing.size()) == kPing) {
+        // answer with the same parameters
+        keepalive_.assign(kPong);
+        keepalive_.append(line.substr(kPing.size()));
+        keepalive_.append(kCRLF);
+        QueueWrite(keepalive_, SwitchBuffer::kControl);
+        return true;
+    }
+    // PONG comes with prefix: ":tmi.twitch.tv PONG tmi.twitch.tv :tmi.twitch.tv"
+    if (line.front() == ':') {
+        const auto command = line.find(' ');
+        if (command != std::string_view::npos
+            && line.substr(command + 1, kPong.size()) == kPong) 
+        {
+            if (pingSent_) {
+                const auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - *pingSent_);
+                metrics_.OnRoundTrip(rtt);
+                pingSent_.reset();
+                LOG_INFO(*log_, "round-trip time: ", rtt.count(), "us");
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void IrcConnection::SchedulePing() {
+    isPingArmed_ = true;
+    pingTimer_.expires_from_now(boost::posix_time::seconds{ kPingInterval });
+    // weak: the timer mustn't keep the connection alive
+    pingTimer_.async_wait(boost::asio::bind_executor(strand_
+        , [weak = utils::WeakFrom<IrcConnection>(shared_from_this())](
+            const boost::system::error_code& error) 
+        {
+            if (auto self = weak.lock(); self) {
+                self->OnPing(error);
+            }
+        }
+    ));
+}
+
+void IrcConnection::OnPing(const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted) {
+        // cancelled by `StopPing` which has already disarmed it
+        return;
+    }
+    isPingArmed_ = false;
+    assert(socket_);
+    if (!socket_->lowest_layer().is_open()) {
+        // the next `Read` after reconnection restarts pinging
+        pingSent_.reset();
+        return;
+    }
+    if (pingSent_) {
+        LOG_WARN(*log_, "previous PING hasn't been answered");
+    }
+    pingSent_ = std::chrono::steady_clock::now();
+    keepalive_.assign(kPing);
+    keepalive_.append(" :");
+    keepalive_.append(host_);
+    keepalive_.append(kCRLF);
+    QueueWrite(keepalive_, SwitchBuffer::kControl);
+    SchedulePing();
+}
+
+void IrcConnection::StopPing() {
+    boost::system::error_code ignored;
+    pingTimer_.cancel(ignored);
+    isPingArmed_ = false;
+    pingSent_.reset();
+}
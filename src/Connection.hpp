@@ -5,6 +5,9 @@
 #include <memory>
 #include <optional>
 #include <functional>
+#include <vector>
+#include <array>
+#include <chrono>
 
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
@@ -12,6 +15,8 @@
 #include "Logger.hpp"
 #include "Response.hpp"
 #include "SwitchBuffer.hpp"
+#include "MpscInbox.hpp"
+#include "ConnectionMetrics.hpp"
 
 using boost::asio::ip::tcp;
 namespace ssl = boost::asio::ssl;
@@ -46,34 +51,140 @@ public:
      * @brief Enque data to be sent when connection is able to write,
      * i.e. `isWritting == false`
      * 
-     * @param text data which will be enqued to the 
-     * switch buffer to be sent with other data at once according to scatter-gether idiom
+     * @param text data which will be copied to the 
+     * switch buffer to be sent with other data at once in one contiguous write
      * @param onWrite callback which will be invoked right after the banch of data will
      * be sent to peer. Callback will be invoked in the same thread 
      * as `OnWrite(const boost::system::error_code&, size_t)` being invoked.
      * @note if there was a banch of data then the corresponding banch of callbacks will be invoked
      * sequentially (see `OnWrite` implementation). This approach leads to following restrictions:
      * - it MUST NOT block or do any "heavy" resource-consuming work.
+     * @param priority control messages are sent before the queued normal ones;
+     * the message is dropped (and `onWrite` is never invoked) when its lane is full,
+     * see `SetOutboxLimits`
      */
-    void ScheduleWrite(std::string text, std::function<void()> onWrite = {});
+    void ScheduleWrite(std::string text
+        , SwitchBuffer::Callback onWrite = {}
+        , SwitchBuffer::Priority priority = SwitchBuffer::kNormal);
+
+    // Bound the queue of the outgoing messages of the given priority.
+    // Thread-safe: applied through `strand_`
+    void SetOutboxLimits(SwitchBuffer::Priority priority, SwitchBuffer::Limits limits);
+
+    // Write coalescing: an idle connection doesn't start writing right away
+    // but waits for more data so a burst is sent in fewer TLS records.
+    struct Coalescing {
+        // max time the queued data waits for more; zero disables coalescing
+        long maxDelay { 0 }; // in milliseconds
+        // write without waiting once this many bytes are queued
+        size_t threshold { 0 };
+    };
+
+    // Thread-safe: applied through `strand_`
+    void SetCoalescing(Coalescing coalescing);
 
     virtual void Read(std::function<void()> onRead = {}) = 0;
 
+    /**
+     * Prepare the idle connection to be reused by another user:
+     * forget callbacks of the previous one. `onReset` is invoked 
+     * through `strand_` after that.
+     * @note MUST be called when no operation is in progress.
+     */
+    void ResetCallbacks(std::function<void()> onReset);
+
+    /**
+     * `onFailure` is invoked when the connection gives up
+     * (see `Abandon`): the pending callbacks won't be invoked.
+     * @note MUST be called when no operation is in progress.
+     */
+    void SetOnFailure(std::function<void()> onFailure) {
+        onFailure_ = std::move(onFailure);
+    }
+
+    /**
+     * Check whether the idle connection can be reused:
+     * socket is open and the peer has neither closed it nor sent anything.
+     * @note MUST be called when no operation is in progress.
+     */
+    bool IsAlive();
+
+    // Stages of the connection's work guarded by a deadline
+    enum Phase : size_t {
+        kNone,
+        kResolve,
+        kConnect,
+        kHandshake,
+        kHeader,
+        kBody,
+        // IRC connection is waiting for any message
+        kIdle,
+        kPhaseCount
+    };
+
+    // Thread-safe: counters are atomic.
+    // Aggregates per host: see `ConnectionMetrics::Report`
+    const ConnectionMetrics::Stats& GetMetrics() const noexcept {
+        return metrics_.GetStats();
+    }
+
 protected:
 
     // NOTE: Can not be called outside because there will be a data race at least around `socket_`.
     // Posting it through `strand_` gurantees that no other handler is being executed in other thread so
-    // it's safe to invoke `Close`
-    void Close();
+    // it's safe to invoke `Close`.
+    // Derived classes stop their own timers here, 
+    // so no handler keeps the closed connection alive
+    virtual void Close();
 
     // repeat the same actions via `onConnectSuccess_` callback 
-    // on successfull reconnection
+    // on successfull reconnection.
+    // NOTE: `onConnectSuccess_` MUST NOT have been invoked yet
+    // unless it's meant to be replayed (see `IrcConnection::SetOnReconnect`)
     void Reconnect();
 
+    // Close the connection for good: notify the user via `onFailure_`
+    // and forget the callbacks (they may own the connection's owner)
+    void Abandon();
+
+    // An operation of the established connection has failed
+    // (I/O error or expired deadline). The callbacks have been invoked 
+    // up to the failed operation, so by default the connection gives up.
+    // NOTE: MUST be called through `strand_`
+    virtual void OnBroken() {
+        Abandon();
+    }
+
     void Write();
 
+    // Move messages from `writeInbox_` to `outbox_` and start writing
+    void DrainWrites();
+
+    // Queue the message bypassing `writeInbox_`.
+    // NOTE: MUST be called through `strand_`
+    void QueueWrite(std::string_view text, SwitchBuffer::Priority priority);
+
+    // Write now or wait for more data according to `coalescing_`
+    void WriteOrDefer();
+
+    void OnFlush(const boost::system::error_code&);
+
     void OnResolve(const boost::system::error_code&, tcp::resolver::results_type);
 
+    // === Happy Eyeballs (RFC 8305) ===
+    // Endpoints are tried in parallel with staggered starts,
+    // the first connected socket wins, the others are closed.
+    struct Race;
+
+    void StartAttempt(const std::shared_ptr<Race>& race);
+
+    void OnAttempt(const std::shared_ptr<Race>& race
+        , size_t index
+        , const boost::system::error_code& error);
+
+    // Close sockets of the race which is in progress
+    void StopRace();
+
     void OnConnect(const boost::system::error_code&, const tcp::endpoint&);
 
     void OnHandshake(const boost::system::error_code&);
@@ -82,11 +193,29 @@ protected:
 
     void OnTimeout(const boost::system::error_code&);
 
+    // === Deadlines ===
+    // Every phase re-arms the same `phaseTimer_`: 
+    // only the current phase can expire.
+    // Zero timeout disables the deadline (the phase is still tracked).
+    void StartPhase(Phase phase, long timeout);
+
+    void StartPhase(Phase phase) {
+        StartPhase(phase, kDeadlines[phase]);
+    }
+
+    void FinishPhase();
+
+    // Report the duration of the current phase which has just succeeded
+    void RecordPhase();
+
+    // Abort the expired phase: connection is re-established 
+    // while connecting, otherwise it's broken (see `OnBroken`)
+    void OnDeadline(const boost::system::error_code&, Phase phase, size_t generation);
+
 protected:
     // === Boost IO stuff ===
     SharedIOContext context_ { nullptr };
     SharedSSLContext ssl_ { nullptr };
-    tcp::resolver resolver_;
     boost::asio::io_context::strand strand_;
     std::optional<Stream> socket_;
     boost::asio::deadline_timer timer_;
@@ -94,18 +223,56 @@ protected:
     const std::string host_;
     const std::string service_;    
     std::shared_ptr<Log> log_ { nullptr };
+    ConnectionMetrics metrics_ { host_ };
 
     // === callbacks ===
     std::function<void()> onConnectSuccess_;
     std::function<void()> onReadSuccess_;
+    std::function<void()> onFailure_;
 
     // === Write ===
+    struct Outgoing {
+        std::string text;
+        SwitchBuffer::Callback onWrite;
+        SwitchBuffer::Priority priority;
+    };
+    // filled by any thread, drained through `strand_`
+    MpscInbox<Outgoing> writeInbox_;
     SwitchBuffer outbox_;
     bool isWriting_ { false };
+    Coalescing coalescing_;
+    // flushes the coalesced data when `maxDelay` elapses
+    boost::asio::deadline_timer flushTimer_;
+    bool isFlushArmed_ { false };
+
+    // === Deadlines ===
+    // in seconds, indexed by `Phase`; IRC sets idle deadline itself
+    static constexpr std::array<long, kPhaseCount> kDeadlines {
+        0,  // none
+        5,  // resolve
+        5,  // connect (all attempts)
+        10, // handshake
+        10, // header
+        30, // body
+        0   // idle
+    };
+    static constexpr std::array<std::string_view, kPhaseCount> kPhaseNames {
+        "none", "resolve", "connect", "handshake", "header", "body", "idle"
+    };
+    boost::asio::deadline_timer phaseTimer_;
+    Phase phase_ { kNone };
+    std::chrono::steady_clock::time_point phaseStart_ {};
+    // tells the handler of the current phase from the stale ones
+    size_t phaseGeneration_ { 0 };
 
     // === Reconnect ===
     static constexpr size_t kReconnectLimit { 3 };
     size_t reconnects_ { 0 };
+
+    // === Connect ===
+    // delay before the next attempt starts if the previous one hasn't completed
+    static constexpr long kAttemptDelay { 250 }; // in milliseconds
+    std::shared_ptr<Race> race_;
 };
 
 class HttpConnection: public Connection {
@@ -118,9 +285,13 @@ public:
     net::http::Message AcquireResponse() noexcept {
         return { std::move(header_), std::move(body_) };
     }
+
 private:
     void ReadHeader();
 
+    // time to first byte is recorded, then the rest of the header is read
+    void OnFirstRead(const boost::system::error_code& error, size_t bytes);
+
     void OnHeaderRead(const boost::system::error_code& error, size_t bytes);
 
     void ReadIntactBody();
@@ -132,28 +303,32 @@ private:
     void OnReadChunkedBody(const boost::system::error_code& error, size_t bytes);
 
 private:
-    struct Chunk final {
-        // size of chunk
-        size_t size_ { 0 };
-        // number of consumed (processed) chunks
-        size_t consumed_ { 0 }; 
-
-        void Reset() noexcept {
-            size_ = consumed_ = 0;
-        }
-    };
-
     static constexpr std::string_view kService { "https" };
-    static constexpr std::string_view kCRLF { "\r\n" };
     static constexpr std::string_view kHeaderDelimiter { "\r\n\r\n" };
+    // max number of bytes read at once while decoding chunked body
+    static constexpr size_t kChunkedReadSize { 16 * 1024 };
+    // max number of bytes of the response read by the first read
+    static constexpr size_t kFirstReadSize { 4 * 1024 };
 
     // buffers
     boost::asio::streambuf inbox_;
-    Chunk chunk_;
+    net::http::ChunkedDecoder decoder_;
     net::http::Header header_;
     net::http::Body body_;
+    // number of bytes of the body with known Content-Length already read
+    size_t bodyRead_ { 0 };
 };
 
+/**
+ * Keepalive is handled here, not by the services: 
+ * PING is answered right in the read path and own PINGs 
+ * are sent periodically to measure the round-trip time
+ * (reported by `ConnectionMetrics`).
+ * Neither PING nor PONG reaches `AcquireResponse`.
+ * 
+ * Broken connection is re-established and `onReconnect` 
+ * (see `SetOnReconnect`) starts the new session, e.g. logs in again.
+ */
 class IrcConnection: public Connection {
 public:
 
@@ -161,16 +336,60 @@ public:
 
     void Read(std::function<void()> onSuccess = {}) override;
 
-    net::irc::Message AcquireResponse() noexcept {
-        return std::move(message_);
+    // return all messages parsed by the last read
+    std::vector<net::irc::Message> AcquireResponse() noexcept {
+        return std::move(messages_);
     }
+
+    // `onReconnect` is invoked instead of the initial `onConnect` 
+    // when the broken connection is re-established.
+    // Without it the broken connection is abandoned.
+    // Thread-safe: applied through `strand_`
+    void SetOnReconnect(std::function<void()> onReconnect);
+
+protected:
+    void Close() override;
+
+    void OnBroken() override;
+
 private:
     void OnRead(const boost::system::error_code& error, size_t bytes);
 
+    // parse all complete lines from `inbox_`,
+    // an incomplete line stays there until the next read
+    void ExtractMessages();
+
+    // return true if the line is PING or PONG and has been handled
+    bool HandleKeepalive(std::string_view line);
+
+    void SchedulePing();
+
+    void OnPing(const boost::system::error_code& error);
+
+    // the session is over: don't ping until the next one is started by `Read`
+    void StopPing();
+
     static constexpr std::string_view kCRLF { "\r\n" };
+    // max number of bytes read at once: one TLS record
+    static constexpr size_t kReadSize { 16 * 1024 };
+    static constexpr std::string_view kPing { "PING" };
+    static constexpr std::string_view kPong { "PONG" };
+    // own PING is sent this often; Twitch pings about every 5 minutes
+    static constexpr long kPingInterval { 30 }; // in seconds
+    // the answer to own PING is late: connection is dead
+    static constexpr long kIdleDeadline { kPingInterval + 15 }; // in seconds
  
     boost::asio::streambuf inbox_;
-    net::irc::Message message_;
+    std::vector<net::irc::Message> messages_;
+    std::function<void()> onReconnect_;
+
+    // === Keepalive ===
+    // reused for every PING/PONG so the reply doesn't allocate
+    std::string keepalive_;
+    boost::asio::deadline_timer pingTimer_ { *context_ };
+    bool isPingArmed_ { false };
+    // own PING which hasn't been answered yet
+    std::optional<std::chrono::steady_clock::time_point> pingSent_;
 };
 
 namespace utils {
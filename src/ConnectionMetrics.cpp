@@ -0,0 +1,108 @@
+#include "ConnectionMetrics.hpp"
+
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+    constexpr std::array<std::string_view, ConnectionMetrics::kStageCount> kStageNames {
+        "resolve", "connect", "handshake", "first byte", "header", "body"
+    };
+
+    template<typename Apply>
+    void ForBoth(ConnectionMetrics::Stats& own
+        , ConnectionMetrics::Stats& host
+        , Apply&& apply) noexcept
+    {
+        apply(own);
+        apply(host);
+    }
+
+} // namespace {
+
+ConnectionMetrics::ConnectionMetrics(std::string_view host)
+    : host_ { Aggregate(host) }
+{
+}
+
+void ConnectionMetrics::OnStage(Stage stage, Duration duration) noexcept {
+    ForBoth(own_, host_, [&](Stats& stats) {
+        stats.latency[stage].Record(duration);
+    });
+}
+
+void ConnectionMetrics::OnRead(std::size_t bytes) noexcept {
+    ForBoth(own_, host_, [&](Stats& stats) {
+        stats.bytesIn.fetch_add(bytes, std::memory_order_relaxed);
+    });
+}
+
+void ConnectionMetrics::OnWrite(std::size_t bytes, std::size_t messages) noexcept {
+    ForBoth(own_, host_, [&](Stats& stats) {
+        stats.bytesOut.fetch_add(bytes, std::memory_order_relaxed);
+        stats.writes.fetch_add(1, std::memory_order_relaxed);
+        stats.messages.fetch_add(messages, std::memory_order_relaxed);
+        auto max = stats.maxBatch.load(std::memory_order_relaxed);
+        while (messages > max
+            && !stats.maxBatch.compare_exchange_weak(max, messages, std::memory_order_relaxed))
+        {}
+    });
+}
+
+void ConnectionMetrics::OnReconnect() noexcept {
+    ForBoth(own_, host_, [](Stats& stats) {
+        stats.reconnects.fetch_add(1, std::memory_order_relaxed);
+    });
+}
+
+void ConnectionMetrics::OnRoundTrip(Duration duration) noexcept {
+    ForBoth(own_, host_, [&](Stats& stats) {
+        stats.roundTrip.Record(duration);
+    });
+}
+
+ConnectionMetrics::Stats& ConnectionMetrics::Aggregate(std::string_view host) {
+    {
+        std::shared_lock lock { mutex_ };
+        if (auto it = hosts_.find(host); it != hosts_.end()) {
+            return *it->second;
+        }
+    }
+    std::unique_lock lock { mutex_ };
+    auto [it, inserted] = hosts_.try_emplace(std::string{ host });
+    if (inserted) {
+        it->second = std::make_unique<Stats>();
+    }
+    return *it->second;
+}
+
+std::string ConnectionMetrics::Report() {
+    std::stringstream ss;
+    std::shared_lock lock { mutex_ };
+    for (const auto& [host, stats]: hosts_) {
+        const auto writes = stats->writes.load(std::memory_order_relaxed);
+        const auto messages = stats->messages.load(std::memory_order_relaxed);
+        ss << host << ":\n"
+            << "  bytes in " << stats->bytesIn.load(std::memory_order_relaxed)
+            << " out " << stats->bytesOut.load(std::memory_order_relaxed)
+            << ", reconnects " << stats->reconnects.load(std::memory_order_relaxed)
+            << ", writes " << writes
+            << " (messages " << messages
+            << ", avg batch " << (writes? static_cast<double>(messages) / writes: 0.0)
+            << ", max batch " << stats->maxBatch.load(std::memory_order_relaxed) << ")\n";
+        const auto print = [&ss](std::string_view name, const command::LatencyHistogram& latency) {
+            const auto summary = latency.Summarize();
+            if (!summary.count) return;
+            ss << "  " << name
+                << " (us): count " << summary.count
+                << " p50 <=" << summary.p50.count()
+                << " p99 <=" << summary.p99.count()
+                << " max " << summary.max.count() << '\n';
+        };
+        for (std::size_t stage = 0; stage < kStageCount; stage++) {
+            print(kStageNames[stage], stats->latency[stage]);
+        }
+        print("round trip", stats->roundTrip);
+    }
+    return ss.str();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+
+#include "QueueMetrics.hpp" // command::LatencyHistogram
+
+/**
+ * Metrics of a connection: latency of every stage of the request
+ * and the traffic. Each record goes both to the connection's own `Stats`
+ * and to the `Stats` aggregated over all connections to the same host,
+ * so remote slowness (resolve, connect, first byte) can be told apart
+ * from our own overhead.
+ * Recording is lock-free: relaxed atomics only.
+ */
+class ConnectionMetrics {
+public:
+    using Duration = std::chrono::nanoseconds;
+
+    enum Stage : std::size_t {
+        kResolve,
+        kConnect,
+        kHandshake,
+        // from the start of the read until its first bytes are received
+        kFirstByte,
+        // from the start of the read until the whole header is received
+        kHeader,
+        kBody,
+        kStageCount
+    };
+
+    struct Stats {
+        std::array<command::LatencyHistogram, kStageCount> latency;
+        // from own PING to the PONG (IRC only)
+        command::LatencyHistogram roundTrip;
+        // payload bytes (TLS is not counted)
+        std::atomic<std::size_t> bytesIn { 0 };
+        std::atomic<std::size_t> bytesOut { 0 };
+        std::atomic<std::size_t> reconnects { 0 };
+        // completed write operations and messages sent by them
+        std::atomic<std::size_t> writes { 0 };
+        std::atomic<std::size_t> messages { 0 };
+        std::atomic<std::size_t> maxBatch { 0 };
+    };
+
+    explicit ConnectionMetrics(std::string_view host);
+
+    ConnectionMetrics(const ConnectionMetrics&) = delete;
+    ConnectionMetrics(ConnectionMetrics&&) = delete;
+    ConnectionMetrics& operator=(const ConnectionMetrics&) = delete;
+    ConnectionMetrics& operator=(ConnectionMetrics&&) = delete;
+
+    void OnStage(Stage stage, Duration duration) noexcept;
+
+    void OnRead(std::size_t bytes) noexcept;
+
+    // one write operation sent `messages` messages at once
+    void OnWrite(std::size_t bytes, std::size_t messages) noexcept;
+
+    void OnReconnect() noexcept;
+
+    void OnRoundTrip(Duration duration) noexcept;
+
+    const Stats& GetStats() const noexcept {
+        return own_;
+    }
+
+    // human-readable snapshot of the aggregates of all hosts
+    static std::string Report();
+
+private:
+    // find or create aggregate for the host
+    static Stats& Aggregate(std::string_view host);
+
+    Stats own_;
+    Stats& host_;
+
+    // aggregates are never removed so the references stay valid
+    static inline std::shared_mutex mutex_ {};
+    static inline std::map<std::string, std::unique_ptr<Stats>, std::less<>> hosts_ {};
+};
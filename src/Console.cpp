@@ -1,6 +1,7 @@
 #include "Console.hpp"
 #include "Utility.hpp"
 #include "Environment.hpp"
+#include "ConnectionMetrics.hpp"
 
 #include <sstream>
 #include <algorithm>
@@ -40,23 +41,25 @@ void PrintError() {
 
 namespace service {
 
-Console::Console(Container * inbox, command::AliasTable * aliases) 
+Console::Console(Container * inbox
+    , command::AliasTable * aliases
+    , const command::QueueMetrics * metrics
+) 
     : inbox_ { inbox }
     , translator_ {}
     , aliases_ { aliases }
+    , metrics_ { metrics }
     , invoker_ { std::make_unique<Invoker>(this) }
 {
     assert(inbox_ != nullptr);
     assert(aliases_ != nullptr);
+    assert(metrics_ != nullptr);
 
-    using namespace std::literals::string_view_literals;
-
-    std::initializer_list<Translator::Pair> list {
-        { "shutdown"sv, Translator::CreateHandle<command::Shutdown>(*this) }
-        , { "help"sv,     Translator::CreateHandle<command::Help>(*this) }
-        , { "alias"sv,    Translator::CreateHandle<command::Alias>(*this) }
-    };
-    translator_.Insert(list);
+    translator_.Insert<command::Shutdown>(*this);
+    translator_.Insert<command::Help>(*this);
+    translator_.Insert<command::Alias>(*this);
+    translator_.Insert<command::QueueStats>(*this);
+    translator_.Insert<command::ConnectionStats>(*this);
 }
 
 Console::~Console() {
@@ -200,14 +203,10 @@ void Console::Dispatch(std::string_view cmd, const command::Args& args) {
     }
     else {
         // can not recognize the command, pass it to other services
-        std::vector<command::ParamData> params;
-        params.reserve(args.size());
-        for (auto&& [k, v]: args) {
-            params.push_back(command::ParamData{ 
-                std::string(k), std::string(v) });
-        }        
-        command::RawCommand raw { std::move(lowerCaseCmd), std::move(params) };
-        if (!inbox_->TryPush(std::move(raw))) {
+        command::RawCommand raw { lowerCaseCmd, args };
+        if (inbox_->Push(std::move(raw), command::kFetch, kOverflow) 
+            == Container::Status::kDropped
+        ) {
             // abandon the command
             Write("[console] fail to proccess command:"
                 " command storage is full\n");
@@ -236,6 +235,8 @@ void Console::Invoker::Execute(command::Help) {
     Console::Write("[console] available commands:\n"
         "  !shutdown - exit the application\n"
         "  !help - show existing commands\n"
+        "  !queue-stats - show command queue statistics\n"
+        "  !connection-stats - show latency and traffic per host\n"
         "  !blizzard-token - acquire token fromn blizzard\n"
         "  !realm-id - get id of the [flamegor] realm\n"
         "  !realm-status - get status of the [flamegor] realm\n"
@@ -248,4 +249,24 @@ void Console::Invoker::Execute(command::Help) {
     );
 }
 
+void Console::Invoker::Execute(command::QueueStats) {
+    const auto inbox = console_->inbox_;
+    for (std::size_t lane = 0; lane < command::kPriorityCount; lane++) {
+        const auto stats = inbox->GetStats(lane);
+        Console::Write("[console] queue lane", lane
+            , ": size", stats.size, '/', inbox->GetCapacity(lane)
+            , "high-water", stats.highWater
+            , "pushed", stats.pushed
+            , "dropped", stats.dropped
+            , "displaced", stats.displaced
+            , "coalesced", stats.coalesced
+            , "timeouts", stats.timeouts, '\n');
+    }
+    Console::Write(console_->metrics_->Report());
+}
+
+void Console::Invoker::Execute(command::ConnectionStats) {
+    Console::Write("[console] connections:\n", ConnectionMetrics::Report());
+}
+
 } // namespace service
\ No newline at end of file
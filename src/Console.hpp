@@ -2,20 +2,23 @@
 
 #include <iostream>
 #include <string>
+#include <chrono>
 
 #include "Command.hpp"
 #include "Translator.hpp"
-#include "ConcurrentQueue.hpp"
 #include "Environment.hpp"
 #include "Alias.hpp"
+#include "QueueMetrics.hpp"
 
 namespace service {
 // This is source of input 
 class Console {
 public:
-    using Container = CcQueue<command::RawCommand, cst::kQueueCapacity>;
+    using Container = command::Queue;
 
-    Console(Container * inbox, command::AliasTable * aliases);
+    Console(Container * inbox
+        , command::AliasTable * aliases
+        , const command::QueueMetrics * metrics);
 
     Console(const Console&) = delete;
     Console(Console&&) = delete;
@@ -45,9 +48,20 @@ private:
 
     class Invoker;
 
+    // user at the console can wait a bit when the queue is full
+    static constexpr Container::Overflow kOverflow { 
+        Container::Overflow::kBlock, std::chrono::milliseconds{ 1000 } };
+
     Container * const inbox_ { nullptr };
-    Translator translator_ {};
+    Translator<command::Shutdown
+        , command::Help
+        , command::Alias
+        , command::QueueStats
+        , command::ConnectionStats
+    > translator_ {};
     command::AliasTable * const aliases_ { nullptr };
+    // consumer-side metrics of the `inbox_`
+    const command::QueueMetrics * const metrics_ { nullptr };
 
     bool running_ { true };
 
@@ -65,6 +79,8 @@ public:
     void Execute(command::Shutdown);
     void Execute(command::Alias);
     void Execute(command::Help);
+    void Execute(command::QueueStats);
+    void Execute(command::ConnectionStats);
 
 private:
     Console * const console_ { nullptr };
@@ -0,0 +1,86 @@
+#include "DnsCache.hpp"
+
+#include <memory>
+
+void DnsCache::Resolve(boost::asio::io_context& context
+    , std::string_view host
+    , std::string_view service
+    , Callback callback
+) {
+    std::string key;
+    key.reserve(host.size() + service.size() + 1);
+    key.append(host).append(1, ':').append(service);
+
+    const auto now { Clock::now() };
+    std::unique_lock<std::mutex> lock { mutex_ };
+    auto& entry = entries_[key];
+    // whether the caller has to wait for the resolution
+    const bool wait { !entry.resolved || entry.expires + kMaxStale <= now };
+    const bool refresh { !entry.refreshing 
+        && (!entry.resolved || entry.expires - kRefreshAhead <= now) };
+    if (refresh) {
+        entry.refreshing = true;
+    }
+    Results results;
+    if (wait) {
+        entry.waiters.push_back(std::move(callback));
+    }
+    else {
+        results = entry.results;
+    }
+    lock.unlock();
+
+    if (refresh) {
+        Refresh(context, std::move(key), host, service);
+    }
+    if (!wait) {
+        boost::asio::post(context, [callback = std::move(callback)
+            , results = std::move(results)
+        ]() {
+            std::invoke(callback, boost::system::error_code{}, results);
+        });
+    }
+}
+
+void DnsCache::Refresh(boost::asio::io_context& context
+    , std::string key
+    , std::string_view host
+    , std::string_view service
+) {
+    auto resolver = std::make_shared<boost::asio::ip::tcp::resolver>(context);
+    resolver->async_resolve(host, service, [resolver, key = std::move(key)](
+        const boost::system::error_code& error, Results results
+    ) {
+        OnRefresh(key, error, std::move(results));
+    });
+}
+
+void DnsCache::OnRefresh(const std::string& key
+    , const boost::system::error_code& error
+    , Results results
+) {
+    std::unique_lock<std::mutex> lock { mutex_ };
+    auto& entry = entries_[key];
+    entry.refreshing = false;
+    if (!error && !results.empty()) {
+        entry.results = results;
+        entry.expires = Clock::now() + kTimeToLive;
+        entry.resolved = true;
+    }
+    // otherwise keep the stale entry (if any): 
+    // it's likely better than nothing
+    auto waiters { std::move(entry.waiters) };
+    entry.waiters.clear();
+    const bool resolved { entry.resolved };
+    results = entry.results;
+    lock.unlock();
+
+    for (auto& waiter: waiters) {
+        if (resolved) {
+            std::invoke(waiter, boost::system::error_code{}, results);
+        }
+        else {
+            std::invoke(waiter, error, Results{});
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+/**
+ * Process-wide cache of resolved endpoints shared by all connections.
+ * 
+ * Asio doesn't expose DNS record's TTL so entries live for `kTimeToLive`.
+ * - fresh entry is returned at once; it's refreshed in the background
+ * when it's about to expire (`kRefreshAhead`)
+ * - expired entry is still returned at once (stale-while-revalidate)
+ * unless it's older than `kMaxStale`: then the caller waits for the refresh
+ * - if the resolver fails the stale entry is used anyway
+ * Concurrent resolutions of the same host are merged into one.
+ */
+class DnsCache {
+public:
+    using Results = boost::asio::ip::tcp::resolver::results_type;
+    using Callback = std::function<void(const boost::system::error_code&, Results)>;
+
+    // `callback` is never invoked inline, but via `context`
+    static void Resolve(boost::asio::io_context& context
+        , std::string_view host
+        , std::string_view service
+        , Callback callback);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::minutes kTimeToLive { 5 };
+    static constexpr std::chrono::seconds kRefreshAhead { 30 };
+    static constexpr std::chrono::hours kMaxStale { 1 };
+
+    struct Entry {
+        Results results;
+        Clock::time_point expires {};
+        // resolved at least once
+        bool resolved { false };
+        // resolution is in progress
+        bool refreshing { false };
+        // callers waiting for the resolution
+        std::vector<Callback> waiters;
+    };
+
+    static void Refresh(boost::asio::io_context& context
+        , std::string key
+        , std::string_view host
+        , std::string_view service);
+
+    static void OnRefresh(const std::string& key
+        , const boost::system::error_code& error
+        , Results results);
+
+    static inline std::mutex mutex_ {};
+    // key is `host:service`
+    static inline std::unordered_map<std::string, Entry> entries_ {};
+};
@@ -0,0 +1,232 @@
+#include "HttpPool.hpp"
+#include "Connection.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+HttpPool::HttpPool(SharedIOContext context
+    , SharedSSLContext ssl
+    , std::string_view host
+    , std::string_view service
+    , std::size_t maxConnections
+)
+    : context_ { context }
+    , ssl_ { ssl }
+    , strand_ { *context }
+    , host_ { host }
+    , service_ { service }
+    , maxConnections_ { maxConnections }
+    , waitTimer_ { *context }
+{
+    assert(context_ && ssl_);
+    assert(maxConnections_ > 0);
+}
+
+void HttpPool::Shutdown() {
+    boost::asio::post(strand_, [self = shared_from_this()]() {
+        self->shutdown_ = true;
+        for (auto& idle: self->idle_) {
+            idle.connection->ScheduleShutdown();
+        }
+        self->idle_.clear();
+    });
+}
+
+void HttpPool::Acquire(std::shared_ptr<Lease> lease, std::function<void()> onReady) {
+    boost::asio::post(strand_, [self = shared_from_this()
+        , waiter = Waiter { std::move(lease), std::move(onReady), Clock::now() }
+    ]() mutable {
+        if (self->active_ < self->maxConnections_) {
+            self->Serve(std::move(waiter));
+        }
+        else {
+            self->waiters_.push_back(std::move(waiter));
+            self->ArmWaitTimer();
+        }
+    });
+}
+
+void HttpPool::Release(std::shared_ptr<HttpConnection> connection, bool reusable) {
+    assert(connection);
+    if (!reusable) {
+        connection->ScheduleShutdown();
+        Vacate();
+        return;
+    }
+    // connection's callbacks keep its previous user alive, 
+    // so forget them before the connection becomes idle
+    connection->ResetCallbacks([self = shared_from_this(), connection]() {
+        boost::asio::post(self->strand_, [self, connection]() {
+            if (self->shutdown_) {
+                connection->ScheduleShutdown();
+            }
+            else {
+                self->idle_.push_back(Idle { connection, Clock::now() });
+            }
+            self->Vacate();
+        });
+    });
+}
+
+void HttpPool::Free(std::shared_ptr<HttpConnection> connection) {
+    boost::asio::post(strand_, [self = shared_from_this()
+        , connection = std::move(connection)
+    ]() {
+        if (connection) {
+            connection->ScheduleShutdown();
+        }
+        self->Vacate();
+    });
+}
+
+void HttpPool::Vacate() {
+    assert(active_ > 0);
+    active_--;
+    ServeWaiters();
+}
+
+void HttpPool::Serve(Waiter waiter) {
+    assert(active_ < maxConnections_);
+    active_++;
+    auto& lease = waiter.lease;
+    lease->counted_ = true;
+    // weak: the lease owns the connection, not vice versa
+    auto onFailure = [weak = std::weak_ptr<Lease>{ lease }]() {
+        if (auto lease = weak.lock(); lease) {
+            boost::asio::post(lease->pool_->strand_, [lease]() {
+                lease->Fail();
+            });
+        }
+    };
+
+    if (auto connection = TakeIdle(); connection) {
+        connection->SetOnFailure(std::move(onFailure));
+        lease->connection_ = std::move(connection);
+        // don't invoke user's code within the pool's strand
+        boost::asio::post(*context_, std::move(waiter.onReady));
+        return;
+    }
+    // cold pool: pay for the resolve, connect and handshake
+    auto connection = std::make_shared<HttpConnection>(
+        context_, ssl_, host_, service_, lastId_++);
+    lease->connection_ = connection;
+    connection->SetOnFailure(std::move(onFailure));
+    // the lease is kept alive by the user's callbacks (i.e., `onReady`),
+    // if the user abandons it the connection is closed
+    connection->Connect(std::move(waiter.onReady));
+}
+
+void HttpPool::ServeWaiters() {
+    while (!waiters_.empty() && active_ < maxConnections_) {
+        auto waiter { std::move(waiters_.front()) };
+        waiters_.pop_front();
+        Serve(std::move(waiter));
+    }
+}
+
+void HttpPool::ArmWaitTimer() {
+    if (isWaitArmed_ || waiters_.empty()) {
+        return;
+    }
+    isWaitArmed_ = true;
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        waiters_.front().since + kWaitTimeout - Clock::now());
+    waitTimer_.expires_from_now(boost::posix_time::milliseconds{ 
+        std::max<std::chrono::milliseconds::rep>(0, left.count()) });
+    waitTimer_.async_wait(boost::asio::bind_executor(strand_
+        , [self = shared_from_this()](const boost::system::error_code& error) {
+            self->isWaitArmed_ = false;
+            if (error != boost::asio::error::operation_aborted) {
+                self->ExpireWaiters();
+            }
+        }
+    ));
+}
+
+void HttpPool::ExpireWaiters() {
+    // waiters are queued in order of their arrival
+    const auto now { Clock::now() };
+    while (!waiters_.empty() && now - waiters_.front().since >= kWaitTimeout) {
+        auto waiter { std::move(waiters_.front()) };
+        waiters_.pop_front();
+        // slots may be leaked or held by slow requests:
+        // anyway the waiter mustn't wait forever
+        waiter.lease->Fail();
+    }
+    ArmWaitTimer();
+}
+
+std::shared_ptr<HttpConnection> HttpPool::TakeIdle() {
+    const auto now { Clock::now() };
+    while (!idle_.empty()) {
+        // the most recently used connection is the most likely alive
+        auto idle { std::move(idle_.back()) };
+        idle_.pop_back();
+        if (now - idle.since < kIdleTimeout && idle.connection->IsAlive()) {
+            return std::move(idle.connection);
+        }
+        idle.connection->ScheduleShutdown();
+    }
+    return nullptr;
+}
+
+HttpPool::Lease::Lease(std::shared_ptr<HttpPool> pool, std::function<void()> onFailure)
+    : pool_ { std::move(pool) }
+    , onFailure_ { std::move(onFailure) }
+{
+    assert(pool_);
+}
+
+HttpPool::Lease::~Lease() {
+    // no handler refers to the lease anymore, 
+    // so its state can be read outside of the pool's `strand_`
+    if (counted_) {
+        // the request wasn't completed: connection state is unknown
+        pool_->Free(std::move(connection_));
+    }
+}
+
+void HttpPool::Lease::Acquire(std::function<void()> onReady) {
+    pool_->Acquire(shared_from_this(), std::move(onReady));
+}
+
+void HttpPool::Lease::Release(bool reusable) {
+    boost::asio::post(pool_->strand_, [self = shared_from_this(), reusable]() {
+        if (!self->counted_) {
+            // already abandoned: the connection is closed
+            return;
+        }
+        self->counted_ = false;
+        assert(self->connection_);
+        self->pool_->Release(std::move(self->connection_), reusable);
+        self->connection_.reset();
+    });
+}
+
+void HttpPool::Lease::Abandon() {
+    boost::asio::post(pool_->strand_, [self = shared_from_this()]() {
+        self->Vacate();
+    });
+}
+
+void HttpPool::Lease::Vacate() {
+    if (!counted_) {
+        return;
+    }
+    counted_ = false;
+    if (connection_) {
+        // the request wasn't completed: connection state is unknown.
+        // `connection_` itself is kept: the user may still `Get` it
+        connection_->ScheduleShutdown();
+    }
+    pool_->Vacate();
+}
+
+void HttpPool::Lease::Fail() {
+    Vacate();
+    if (auto onFailure = std::move(onFailure_); onFailure) {
+        onFailure_ = nullptr;
+        // don't invoke user's code within the pool's strand
+        boost::asio::post(*pool_->context_, std::move(onFailure));
+    }
+}
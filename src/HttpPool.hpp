@@ -0,0 +1,172 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+
+class HttpConnection;
+
+/**
+ * Pool of persistent (HTTP/1.1 keep-alive) connections to one host.
+ * 
+ * Only a cold pool pays resolve, TCP connect and TLS handshake: 
+ * released connections are kept idle and handed to the next user 
+ * after validation (see `Connection::IsAlive`).
+ * Number of connections in use (being connected or leased) is capped,
+ * the users over the cap wait for a released connection 
+ * not longer than `kWaitTimeout`.
+ * 
+ * The state of the pool is touched only through `strand_`.
+ */
+class HttpPool 
+    : public std::enable_shared_from_this<HttpPool> 
+{
+public:
+    using SharedIOContext = std::shared_ptr<boost::asio::io_context>;
+    using SharedSSLContext = std::shared_ptr<boost::asio::ssl::context>;
+    using Clock = std::chrono::steady_clock;
+
+    class Lease;
+
+    HttpPool(SharedIOContext context
+        , SharedSSLContext ssl
+        , std::string_view host
+        , std::string_view service
+        , std::size_t maxConnections
+    );
+
+    HttpPool(const HttpPool&) = delete;
+    HttpPool(HttpPool&&) = delete;
+    HttpPool& operator=(const HttpPool&) = delete;
+    HttpPool& operator=(HttpPool&&) = delete;
+
+    // Close idle connections and stop pooling released ones
+    void Shutdown();
+
+    const std::string& GetHost() const noexcept {
+        return host_;
+    }
+
+private:
+    struct Idle {
+        std::shared_ptr<HttpConnection> connection;
+        Clock::time_point since;
+    };
+
+    struct Waiter {
+        std::shared_ptr<Lease> lease;
+        std::function<void()> onReady;
+        Clock::time_point since;
+    };
+
+    // Give the lease a connected connection and invoke `onReady`
+    void Acquire(std::shared_ptr<Lease> lease, std::function<void()> onReady);
+
+    // the slot of the lease which didn't return its connection
+    // (the connection, if any, is closed)
+    void Free(std::shared_ptr<HttpConnection> connection);
+
+    // must be called within `strand_`:
+    void Release(std::shared_ptr<HttpConnection> connection, bool reusable);
+    void Vacate();
+    void Serve(Waiter waiter);
+    void ServeWaiters();
+    std::shared_ptr<HttpConnection> TakeIdle();
+    // wait for the oldest waiter's timeout
+    void ArmWaitTimer();
+    // fail waiters which have been waiting too long
+    void ExpireWaiters();
+
+    // idle connection is likely to be closed by server after that
+    static constexpr std::chrono::seconds kIdleTimeout { 30 };
+    // the request is useless for the chatter after that anyway
+    static constexpr std::chrono::seconds kWaitTimeout { 10 };
+
+    SharedIOContext context_;
+    SharedSSLContext ssl_;
+    boost::asio::io_context::strand strand_;
+    const std::string host_;
+    const std::string service_;
+    const std::size_t maxConnections_ { 1 };
+
+    // number of connections which are being connected or leased
+    std::size_t active_ { 0 };
+    // the most recently released are at the back
+    std::vector<Idle> idle_;
+    std::deque<Waiter> waiters_;
+    boost::asio::deadline_timer waitTimer_;
+    bool isWaitArmed_ { false };
+    bool shutdown_ { false };
+    // used for connections' log names
+    std::size_t lastId_ { 0 };
+};
+
+/**
+ * Connection borrowed from the pool for one request.
+ * 
+ * Connection is returned to the pool via `Release` when the response 
+ * is read. Otherwise it's closed and its slot is freed by `Abandon`:
+ * - by the pool when the connection fails or the wait for it times out
+ *   (`onFailure` is invoked then);
+ * - by the user, e.g., when the request's deadline has passed;
+ * - on lease destruction.
+ * 
+ * The lease is owned by the user's callbacks only: 
+ * the connection never owns its lease.
+ * 
+ * Thread-safety: the state of the lease is modified only within 
+ * the pool's `strand_`. `connection_` is assigned there before `onReady` 
+ * is invoked and stays the same until `Release` is applied, 
+ * so the user can `Get` it from any thread in between.
+ */
+class HttpPool::Lease 
+    : public std::enable_shared_from_this<HttpPool::Lease> 
+{
+public:
+    explicit Lease(std::shared_ptr<HttpPool> pool, std::function<void()> onFailure = {});
+
+    Lease(const Lease&) = delete;
+    Lease(Lease&&) = delete;
+    Lease& operator=(const Lease&) = delete;
+    Lease& operator=(Lease&&) = delete;
+
+    ~Lease();
+
+    // `onReady` is invoked when `Get` returns connected connection.
+    // NOTE: lease can hold only one connection: MUST be called once
+    void Acquire(std::function<void()> onReady);
+
+    const std::shared_ptr<HttpConnection>& Get() const noexcept {
+        return connection_;
+    }
+
+    // Return the connection to the pool. 
+    // `reusable == false` closes it (e.g., server sent `Connection: close`).
+    // NOTE: `Get` MUST NOT be used after it
+    void Release(bool reusable);
+
+    // Close the connection (its state is unknown) and free the slot
+    void Abandon();
+
+private:
+    friend class HttpPool;
+
+    // must be called within the pool's `strand_`:
+    // close the connection and free the slot
+    void Vacate();
+    // `Vacate` and notify the user
+    void Fail();
+
+    std::shared_ptr<HttpPool> pool_;
+    std::function<void()> onFailure_;
+    std::shared_ptr<HttpConnection> connection_;
+    // the lease occupies one of the pool's `active_` slots
+    bool counted_ { false };
+};
@@ -0,0 +1,136 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Move-only `void()` callable with small buffer optimization.
+ *
+ * Callables up to `kCapacity` bytes (e.g. lambdas capturing a couple
+ * of shared pointers or a `std::function`) are stored inline so neither
+ * construction nor move touches the heap. Bigger ones are allocated.
+ * Unlike `std::function` it accepts move-only callables.
+ */
+class InplaceCallback {
+public:
+    static constexpr std::size_t kCapacity { 48 };
+
+    InplaceCallback() noexcept = default;
+
+    InplaceCallback(std::nullptr_t) noexcept {}
+
+    template<typename F
+        , typename Callable = std::decay_t<F>
+        , typename = std::enable_if_t<!std::is_same_v<Callable, InplaceCallback>
+            && std::is_invocable_r_v<void, Callable&>>
+    >
+    InplaceCallback(F&& callable) {
+        if constexpr (std::is_constructible_v<bool, const Callable&>) {
+            // empty `std::function` or null function pointer
+            if (!static_cast<bool>(callable)) return;
+        }
+        if constexpr (kIsInline<Callable>) {
+            ::new (static_cast<void*>(storage_)) Callable(std::forward<F>(callable));
+        }
+        else {
+            ::new (static_cast<void*>(storage_)) Callable*(new Callable(std::forward<F>(callable)));
+        }
+        ops_ = &kOps<Callable>;
+    }
+
+    InplaceCallback(InplaceCallback&& other) noexcept {
+        MoveFrom(other);
+    }
+
+    InplaceCallback& operator=(InplaceCallback&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    InplaceCallback(const InplaceCallback&) = delete;
+    InplaceCallback& operator=(const InplaceCallback&) = delete;
+
+    ~InplaceCallback() {
+        Reset();
+    }
+
+    void operator()() {
+        assert(ops_ && "Callback is empty");
+        ops_->invoke(storage_);
+    }
+
+    explicit operator bool() const noexcept {
+        return ops_ != nullptr;
+    }
+
+    void Reset() noexcept {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void *storage);
+        // move-construct `dst` from `src` and destroy `src`
+        void (*relocate)(void *dst, void *src) noexcept;
+        void (*destroy)(void *storage) noexcept;
+    };
+
+    template<typename Callable>
+    static constexpr bool kIsInline { sizeof(Callable) <= kCapacity
+        && alignof(Callable) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible_v<Callable>
+    };
+
+    template<typename Callable>
+    static Callable* Get(void *storage) noexcept {
+        if constexpr (kIsInline<Callable>) {
+            return std::launder(static_cast<Callable*>(storage));
+        }
+        else {
+            return *std::launder(static_cast<Callable**>(storage));
+        }
+    }
+
+    template<typename Callable>
+    static constexpr Ops kOps {
+        [](void *storage) {
+            (*Get<Callable>(storage))();
+        },
+        [](void *dst, void *src) noexcept {
+            if constexpr (kIsInline<Callable>) {
+                ::new (dst) Callable(std::move(*Get<Callable>(src)));
+                Get<Callable>(src)->~Callable();
+            }
+            else {
+                // the heap object is owned by `dst` now
+                ::new (dst) Callable*(Get<Callable>(src));
+            }
+        },
+        [](void *storage) noexcept {
+            if constexpr (kIsInline<Callable>) {
+                Get<Callable>(storage)->~Callable();
+            }
+            else {
+                delete Get<Callable>(storage);
+            }
+        }
+    };
+
+    void MoveFrom(InplaceCallback& other) noexcept {
+        if (other.ops_) {
+            other.ops_->relocate(storage_, other.storage_);
+            ops_ = std::exchange(other.ops_, nullptr);
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[kCapacity];
+    const Ops *ops_ { nullptr };
+};
@@ -113,6 +113,7 @@ IrcShard::IrcShard(Twitch *service
     , command::Queue *rawCommands
     , command::AliasTable *aliases
     , SharedIO context
+    , Strand strand
     , SharedSSL ssl
 ) 
     : buckets_ { 
@@ -124,6 +125,7 @@ IrcShard::IrcShard(Twitch *service
     , translator_ {}
     , aliases_ { aliases }
     , context_ { context }
+    , strand_ { strand }
     , ssl_ { ssl }
     , invoker_ { std::make_unique<Invoker>(this) }
 {
@@ -131,15 +133,9 @@ IrcShard::IrcShard(Twitch *service
     assert(rawCommands);
     assert(context && ssl);
     
-    using namespace std::literals::string_view_literals;
-    std::initializer_list<Translator::Pair> commands {
-        { "help"sv,         Translator::CreateHandle<command::Help>(*service) },
-        // TODO: rename to pong!
-        { "ping"sv,         Translator::CreateHandle<command::Pong>(*service) },
-        { "arena"sv,        Translator::CreateHandle<command::Arena>(*service) },
-        { "realm-status"sv, Translator::CreateHandle<command::RealmStatus>(*service) }
-    };
-    translator_.Insert(commands);
+    translator_.Insert<command::Help>(*service);
+    translator_.Insert<command::Arena>(*service);
+    translator_.Insert<command::RealmStatus>(*service);
 
     const size_t id { 0 };
     irc_ = std::make_shared<IrcConnection>(context_
@@ -147,6 +143,9 @@ IrcShard::IrcShard(Twitch *service
         , request::twitch::kHost
         , request::twitch::kService
         , id);
+    irc_->SetCoalescing({ kWriteDelay, kWriteThreshold });
+    irc_->SetOutboxLimits(SwitchBuffer::kControl, kControlLimits);
+    irc_->SetOutboxLimits(SwitchBuffer::kNormal, kChatLimits);
 }
 
 IrcShard::~IrcShard() {
@@ -273,13 +272,8 @@ void IrcShard::HandleResponse(net::irc::Message message) {
             HandlePrivateMessage(message);
         } break;
         case IrcCommands::kPing: {
-            if (auto handle = translator_.GetHandle("ping"); handle) {
-                // This is a shortcut: 
-                // avoiding global queue (processed in App type)
-                // I call Invoker::Execute when connection has 
-                // just read incoming message
-                std::invoke(*handle, Translator::Params{});
-            }
+            // `IrcConnection` answers PING itself so it never gets here
+            assert(false);
         } break;
         default: assert(false);
     }
@@ -306,19 +300,7 @@ void IrcShard::Invoker::Execute(command::Ping cmd) {
     auto pingRequest = request::twitch::Ping{cmd.channel_}.Build();
     shard_->irc_->ScheduleWrite(std::move(pingRequest), []() {
         Console::Write("[twitch] send pong request\n");
-    });
-}
-
-void IrcShard::Invoker::Execute(command::Pong) {
-    assert(shard_ && "Cannot be null");
-    assert(shard_->irc_ && "irc connection is not established");
-
-    // TODO: still need to handle the case 
-    // when `irc_` failed [re-]connect!
-    auto pongRequest = request::twitch::Pong{}.Build();
-    shard_->irc_->ScheduleWrite(std::move(pongRequest), []() {
-        Console::Write("[twitch] send pong request\n");
-    });
+    }, SwitchBuffer::kControl);
 }
 
 void IrcShard::Invoker::Execute(command::Validate) {
@@ -373,7 +355,7 @@ void IrcShard::Invoker::Execute(command::Validate) {
         }
     };
 
-    auto chain = std::make_shared<Chain>(shard_->context_);
+    auto chain = std::make_shared<Chain>(shard_->strand_);
     (*chain).Add(std::move(connect))
         .Add(std::move(write))
         .Add(std::move(read), std::move(readCallback))
@@ -401,6 +383,12 @@ void IrcShard::Invoker::Execute(command::Join cmd) {
         return;
     }
     
+    auto& channels = shard_->channels_;
+    const bool isKnown = std::any_of(channels.begin(), channels.end()
+        , [&cmd](const Channel& channel) { return channel.name == cmd.channel_; });
+    if (!isKnown) {
+        channels.push_back(Channel{ cmd.channel_ });
+    }
     auto join = request::twitch::Join{cmd.channel_}.Build();
     shard_->irc_->ScheduleWrite(std::move(join), [ticket]() mutable {
         Console::Write("[twitch] send join channel request\n");
@@ -440,6 +428,10 @@ void IrcShard::Invoker::Execute(command::Leave cmd) {
     assert(shard_->irc_ && "irc connection is not established");
     // TODO: still need to handle the case 
     // when `irc_` failed [re-]connect!
+    auto& channels = shard_->channels_;
+    channels.erase(std::remove_if(channels.begin(), channels.end()
+        , [&cmd](const Channel& channel) { return channel.name == cmd.channel_; })
+        , channels.end());
     auto leave = request::twitch::Leave{cmd.channel_}.Build();
     shard_->irc_->ScheduleWrite(std::move(leave), [] {
         Console::Write("[twitch] sent part channel request\n");
@@ -453,6 +445,18 @@ void IrcShard::Invoker::Execute(command::Login cmd) {
     // TODO: still need to handle the case 
     // when all attempt to reconnect failed!
 
+    // the new session knows nothing about the old one: 
+    // authenticate and join channels again
+    shard_->irc_->SetOnReconnect([shard = shard_, cmd]() {
+        boost::asio::post(shard->strand_, [shard, cmd]() {
+            Console::Write("[twitch] reconnected: login again\n");
+            shard->invoker_->Login(cmd, true);
+        });
+    });
+    Login(std::move(cmd), false);
+}
+
+void IrcShard::Invoker::Login(command::Login cmd, bool reconnected) {
     // only PASS is counted as rate-limited command!
     auto& chatBucket = shard_->buckets_[Bucket::kGeneral];
     auto ticket = chatBucket.TryAcquire();
@@ -470,27 +474,39 @@ void IrcShard::Invoker::Execute(command::Login cmd) {
         // handle resoponse
         // TODO: I think this should be posted to execution
         // and not processed here. Connection should not wait!
-        shard->HandleResponse(irc->AcquireResponse());
+        for (auto&& message: irc->AcquireResponse()) {
+            shard->HandleResponse(std::move(message));
+        }
     };
 
     auto connect = [irc](Chain::Callback cb) {
         irc->Connect(std::move(cb));
     };
     auto write = [irc, request = std::move(request)](Chain::Callback cb) {
-        irc->ScheduleWrite(std::move(request), std::move(cb));
+        // CAP, PASS and NICK
+        irc->ScheduleWrite(std::move(request), std::move(cb), SwitchBuffer::kControl);
     };
     // It needed to be executed only once and after socket write completion
     auto releaseTicket = [ticket = std::move(ticket)] () mutable {
         assert(ticket);
         ticket->Release();
     };
+    auto rejoin = [shard = shard_]() {
+        // `Execute(Join)` doesn't add known channels so iteration is safe
+        for (const auto& channel: shard->channels_) {
+            shard->invoker_->Execute(command::Join{ channel.name });
+        }
+    };
     auto read = [irc](Chain::Callback cb) {
         irc->Read(std::move(cb));
     };
 
-    auto chain = std::make_shared<Chain>(shard_->context_);
-    (*chain).Add(std::move(connect))
-        .Add(std::move(write), std::move(releaseTicket))
+    auto chain = std::make_shared<Chain>(shard_->strand_);
+    if (!reconnected) {
+        chain->Add(std::move(connect));
+    }
+    (*chain).Add(std::move(write), std::move(releaseTicket))
+        .Add(std::move(rejoin))
         .Add(std::move(read), std::move(readCallback))
         .Execute();
 }
@@ -502,18 +518,24 @@ void IrcShard::Invoker::Execute(command::RealmStatus cmd) {
     Console::Write("[twitch] execute realm-status command:"
         , cmd.channel_, cmd.user_, '\n');
     command::RawCommand raw { 
-        "realm-status", std::initializer_list<command::ParamData> { 
-            { "channel", std::move(cmd.channel_) },
-            { "user", std::move(cmd.user_) } 
+        "realm-status", { 
+            { "channel", cmd.channel_ },
+            { "user", cmd.user_ } 
         }
     };
+    raw.SetDeadline(raw.GetEnqueueTime() + kReplyDeadline);
 
-    if (shard_->commands_->TryPush(std::move(raw))) {
-        Console::Write("[twitch] push `RealmStatus` to queue\n");
-    }
-    else {
-        Console::Write("[twitch] failed to push "
-            "`RealmStatus`. Queue is full\n");
+    switch (shard_->commands_->Push(std::move(raw), command::kFetch, kOverflow)) {
+        case command::Queue::Status::kDropped: {
+            Console::Write("[twitch] failed to push "
+                "`RealmStatus`. Queue is full\n");
+        } break;
+        case command::Queue::Status::kCoalesced: {
+            Console::Write("[twitch] `RealmStatus` is already queued\n");
+        } break;
+        default: {
+            Console::Write("[twitch] push `RealmStatus` to queue\n");
+        } break;
     }
 }
 
@@ -525,18 +547,24 @@ void IrcShard::Invoker::Execute(command::Arena cmd) {
         , cmd.channel_, cmd.user_, cmd.player_, '\n');
 
     command::RawCommand raw { 
-        "arena", std::initializer_list<command::ParamData> { 
-            { "channel", std::move(cmd.channel_) },
-            { "user", std::move(cmd.user_) }, 
-            { "player", std::move(cmd.player_) } 
+        "arena", { 
+            { "channel", cmd.channel_ },
+            { "user", cmd.user_ }, 
+            { "player", cmd.player_ } 
         }
     };
+    raw.SetDeadline(raw.GetEnqueueTime() + kReplyDeadline);
 
-    if (shard_->commands_->TryPush(std::move(raw))) {
-        Console::Write("[twitch] push `arena` to queue\n");
-    }
-    else {
-        Console::Write("[twitch] failed to push `arena` to queue is full\n");
+    switch (shard_->commands_->Push(std::move(raw), command::kFetch, kOverflow)) {
+        case command::Queue::Status::kDropped: {
+            Console::Write("[twitch] failed to push `arena` to queue is full\n");
+        } break;
+        case command::Queue::Status::kCoalesced: {
+            Console::Write("[twitch] `arena` is already queued\n");
+        } break;
+        default: {
+            Console::Write("[twitch] push `arena` to queue\n");
+        } break;
     }
 }
 
@@ -15,6 +15,7 @@
 #include "Translator.hpp"
 #include "Alias.hpp"
 #include "Response.hpp" // net::irc::Message
+#include "SwitchBuffer.hpp" // outbox limits
 
 class IrcConnection;
 
@@ -104,11 +105,13 @@ class IrcShard final {
 public:
     using SharedIO = std::shared_ptr<boost::asio::io_context>;
     using SharedSSL = std::shared_ptr<boost::asio::ssl::context>;
+    using Strand = boost::asio::io_context::strand;
 
     IrcShard(Twitch *service
         , command::Queue *commands
         , command::AliasTable *alias
         , SharedIO context
+        , Strand strand
         , SharedSSL ssl);
 
     // ASSUME: `irc_->ScheduleShutdown()` has already been called, 
@@ -136,6 +139,21 @@ private:
     static constexpr std::uint16_t kRefillAmount{ 20 };
     static constexpr Seconds kGeneralRefillRate{ 10 };
     static constexpr Seconds kChannelRefillRate{ 30 };
+    // chatter won't wait for the answer longer
+    static constexpr Seconds kReplyDeadline{ 10 };
+    // chatters tend to repeat the same command while waiting for the answer
+    static constexpr command::Queue::Overflow kOverflow { 
+        command::Queue::Overflow::kCoalesce };
+    // replies to a burst of chat commands are sent together:
+    // a few milliseconds of delay for fewer TLS records
+    static constexpr long kWriteDelay { 5 }; // in milliseconds
+    static constexpr size_t kWriteThreshold { 4096 }; // in bytes
+    // keep memory bounded when Twitch reads slowly:
+    // stale chat replies are dropped first, control messages are rare
+    static constexpr SwitchBuffer::Limits kControlLimits { 
+        64, 16 * 1024, SwitchBuffer::Overflow::kDropNewest };
+    static constexpr SwitchBuffer::Limits kChatLimits { 
+        128, 64 * 1024, SwitchBuffer::Overflow::kDropOldest };
     
     struct Channel {
         std::string name; // unique
@@ -152,12 +170,14 @@ private:
     // required for creating HTTP connection
     Twitch *const service_ { nullptr };
     command::Queue *const commands_ { nullptr };
-    Translator translator_;
+    Translator<command::Help, command::Arena, command::RealmStatus> translator_;
     // Keep bindings of [aliases] to [commands with parameters]
     command::AliasTable *const aliases_ { nullptr };
 
     // Contexts for connection's creation
     SharedIO context_;
+    // strand of the service: chains are executed within it
+    Strand strand_;
     SharedSSL ssl_;
 
     // Thread-safety:
@@ -169,7 +189,8 @@ private:
     //  will be destroyed.
     std::shared_ptr<IrcConnection> irc_;
 
-    // List of connected channels
+    // List of joined channels: they are joined again after reconnection.
+    // Accessed only within `strand_`
     std::vector<Channel> channels_;
 
     class Invoker;
@@ -182,7 +203,6 @@ public:
 
     void Execute(command::Help);
     void Execute(command::Ping);
-    void Execute(command::Pong);
     void Execute(command::Shutdown);
     void Execute(command::Validate);
     void Execute(command::Login);
@@ -193,6 +213,11 @@ public:
     void Execute(command::Arena);
 
 private:
+    // CAP, PASS, NICK then JOIN known channels and start reading.
+    // `reconnected`: the connection is already re-established.
+    // NOTE: MUST be called within `shard_->strand_`
+    void Login(command::Login cmd, bool reconnected);
+
     IrcShard * const shard_ { nullptr };
 };
 
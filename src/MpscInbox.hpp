@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**
+ * Unbounded lock-free multi-producer/single-consumer inbox.
+ *
+ * Producers push nodes to the head of an intrusive list with one CAS.
+ * The consumer detaches the whole list with one exchange and handles
+ * it in FIFO order, so a single wakeup drains everything queued so far.
+ * `Push` reports the empty -> non-empty transition: only that producer
+ * needs to wake the consumer up.
+ */
+template<typename T>
+class MpscInbox {
+public:
+    MpscInbox() = default;
+
+    MpscInbox(const MpscInbox&) = delete;
+    MpscInbox& operator=(const MpscInbox&) = delete;
+    MpscInbox(MpscInbox&&) = delete;
+    MpscInbox& operator=(MpscInbox&&) = delete;
+
+    ~MpscInbox() {
+        Release(head_.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    // return true if the inbox was empty before the push
+    bool Push(T value) {
+        auto node = new Node { std::move(value), head_.load(std::memory_order_relaxed) };
+        while (!head_.compare_exchange_weak(node->next, node
+            , std::memory_order_release
+            , std::memory_order_relaxed))
+        {
+            // `node->next` was reloaded by failed CAS
+        }
+        return node->next == nullptr;
+    }
+
+    // Invoke `handle(T&)` for every value pushed so far in the order of pushes.
+    // return number of handled values
+    // Note: MUST be called by one consumer at a time
+    template<typename Handler>
+    std::size_t Drain(Handler&& handle) {
+        Node *node = head_.exchange(nullptr, std::memory_order_acquire);
+        // the list is LIFO: reverse it
+        Node *ordered { nullptr };
+        while (node) {
+            auto next = node->next;
+            node->next = ordered;
+            ordered = node;
+            node = next;
+        }
+        std::size_t count { 0 };
+        for (node = ordered; node; node = node->next, count++) {
+            handle(node->value);
+        }
+        Release(ordered);
+        return count;
+    }
+
+private:
+    struct Node {
+        T value;
+        Node *next { nullptr };
+    };
+
+    static void Release(Node *node) noexcept {
+        while (node) {
+            delete std::exchange(node, node->next);
+        }
+    }
+
+    std::atomic<Node*> head_ { nullptr };
+};
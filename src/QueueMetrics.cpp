@@ -0,0 +1,90 @@
+#include "QueueMetrics.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace command {
+
+void LatencyHistogram::Record(Duration duration) noexcept {
+    const auto us = std::max<Microseconds::rep>(0
+        , std::chrono::duration_cast<Microseconds>(duration).count());
+    // index of the highest bit + 1 (0 for zero)
+    std::size_t bucket { 0 };
+    for (auto value = us; value > 0 && bucket + 1 < kBuckets; value >>= 1) {
+        bucket++;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    auto max = max_.load(std::memory_order_relaxed);
+    while (us > max && !max_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+}
+
+LatencyHistogram::Summary LatencyHistogram::Summarize() const noexcept {
+    std::array<std::size_t, kBuckets> snapshot;
+    Summary summary;
+    for (std::size_t i = 0; i < kBuckets; i++) {
+        snapshot[i] = buckets_[i].load(std::memory_order_relaxed);
+        summary.count += snapshot[i];
+    }
+    summary.max = Microseconds { max_.load(std::memory_order_relaxed) };
+    if (!summary.count) {
+        return summary;
+    }
+
+    const auto percentile = [&](std::size_t permille) {
+        // rank of the value, 1-based
+        const std::size_t rank { std::max<std::size_t>(1
+            , (summary.count * permille + 999) / 1000) };
+        std::size_t seen { 0 };
+        for (std::size_t i = 0; i < kBuckets; i++) {
+            seen += snapshot[i];
+            if (seen >= rank) {
+                // bucket `i` covers [2^(i-1), 2^i) microseconds
+                return std::min(summary.max, Microseconds { Microseconds::rep{ 1 } << i });
+            }
+        }
+        return summary.max;
+    };
+    summary.p50 = percentile(500);
+    summary.p99 = percentile(990);
+    return summary;
+}
+
+QueueMetrics::QueueMetrics(std::size_t workers, std::vector<std::string_view> commands) 
+    : workers_ { workers }
+    , idle_ { std::make_unique<std::atomic<Duration::rep>[]>(workers) }
+    , commands_ { std::move(commands) }
+    , latency_ { std::make_unique<LatencyHistogram[]>(commands_.size() + 1) }
+{
+    for (std::size_t i = 0; i < workers_; i++) {
+        idle_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+std::string QueueMetrics::Report() const {
+    if constexpr (!kEnabled) {
+        return "queue metrics are disabled (build with CHATTERFINITY_QUEUE_METRICS)\n";
+    }
+    std::stringstream ss;
+    ss << "queueing latency (us):\n";
+    for (std::size_t i = 0; i <= commands_.size(); i++) {
+        const auto summary = latency_[i].Summarize();
+        if (!summary.count) {
+            continue;
+        }
+        ss << "  " << (i < commands_.size()? commands_[i]: "unknown")
+            << ": count " << summary.count
+            << " p50 <=" << summary.p50.count()
+            << " p99 <=" << summary.p99.count()
+            << " max " << summary.max.count() << '\n';
+    }
+    ss << "worker idle time (ms):";
+    for (std::size_t i = 0; i < workers_; i++) {
+        const Duration idle { idle_[i].load(std::memory_order_relaxed) };
+        ss << ' ' << std::chrono::duration_cast<std::chrono::milliseconds>(idle).count();
+    }
+    ss << '\n';
+    return ss.str();
+}
+
+} // namespace command
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace command {
+
+/**
+ * Histogram of durations with power-of-two buckets in microseconds:
+ * [0, 1), [1, 2), [2, 4), ... [2^30, inf)
+ * Recording is lock-free.
+ */
+class LatencyHistogram {
+public:
+    using Duration = std::chrono::nanoseconds;
+    using Microseconds = std::chrono::microseconds;
+
+    static constexpr std::size_t kBuckets { 32 };
+
+    struct Summary {
+        std::size_t count { 0 };
+        // upper bounds of the buckets which contain the percentile
+        Microseconds p50 { 0 };
+        Microseconds p99 { 0 };
+        Microseconds max { 0 };
+    };
+
+    void Record(Duration duration) noexcept;
+
+    Summary Summarize() const noexcept;
+
+private:
+    std::array<std::atomic<std::size_t>, kBuckets> buckets_ {};
+    std::atomic<Microseconds::rep> max_ { 0 };
+};
+
+/**
+ * Instrumentation of `command::Queue` from the consumer's side:
+ * - time spent by the command in the queue per command; commands
+ *   are known upfront (see `Translator::kIdentities`), 
+ *   unknown ones share one histogram
+ * - time spent by the workers waiting for the commands
+ * 
+ * Occupancy and push failures are counted by the queue itself (see `Scheduler::Stats`).
+ * Everything is compiled out unless `CHATTERFINITY_QUEUE_METRICS` is defined.
+ */
+class QueueMetrics {
+public:
+    using Duration = std::chrono::nanoseconds;
+
+#ifdef CHATTERFINITY_QUEUE_METRICS
+    static constexpr bool kEnabled { true };
+#else
+    static constexpr bool kEnabled { false };
+#endif
+
+    // `commands` are indexed the same way as the dispatcher's ones
+    QueueMetrics(std::size_t workers, std::vector<std::string_view> commands);
+
+    QueueMetrics(const QueueMetrics&) = delete;
+    QueueMetrics(QueueMetrics&&) = delete;
+    QueueMetrics& operator=(const QueueMetrics&) = delete;
+    QueueMetrics& operator=(QueueMetrics&&) = delete;
+
+    // enqueue-to-dequeue latency of the command with the given index;
+    // out of range index is the unknown command
+    void OnDequeue(std::size_t command, Duration latency) noexcept {
+        if constexpr (kEnabled) {
+            latency_[std::min(command, commands_.size())].Record(latency);
+        }
+    }
+
+    // time the worker was waiting for commands
+    void OnIdle(std::size_t worker, Duration idle) noexcept {
+        if constexpr (kEnabled) {
+            idle_[worker].fetch_add(idle.count(), std::memory_order_relaxed);
+        }
+    }
+
+    // human-readable snapshot
+    std::string Report() const;
+
+private:
+    const std::size_t workers_ { 0 };
+    // total idle time per worker in nanoseconds
+    std::unique_ptr<std::atomic<Duration::rep>[]> idle_;
+
+    const std::vector<std::string_view> commands_;
+    // one per command and the last one for all unknown commands
+    std::unique_ptr<LatencyHistogram[]> latency_;
+};
+
+} // namespace command
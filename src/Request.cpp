@@ -80,10 +80,6 @@ std::string Ping::Build() const {
     return "PING "s + channel_ + "\r\n"s;
 }
 
-std::string Pong::Build() const {
-    return "PONG :tmi.twitch.tv\r\n";
-}
-
 std::string Chat::Build() const {
     const char *requestTemplate = "PRIVMSG #%1% :%2%\r\n";
     return (boost::format(requestTemplate) % channel_ % message_).str();
@@ -59,14 +59,6 @@ namespace twitch {
         std::string channel_;
     };
 
-    class Pong : public Query {
-    public:
-
-        Pong() = default;
-
-        std::string Build() const override;
-    };
-
     class Join : public Query {
     public:
 
@@ -42,6 +42,8 @@ Header ParseHeader(std::string_view src) {
     // default values:
     result.bodyKind_ = BodyContentKind::kUnknown;
     result.bodyLength_ = std::string_view::npos;
+    // HTTP/1.1 connections are persistent unless the server says otherwise
+    result.keepAlive_ = !utils::ascii::IsEqual(result.httpVersion_, "HTTP/1.0");
     // extract FIELDS
     for (size_t start = statusEnd, finish = src.find_first_of(kFieldDelimiter.data(), statusEnd); 
         start < src.size();
@@ -70,6 +72,14 @@ Header ParseHeader(std::string_view src) {
             result.bodyKind_ = BodyContentKind::kChunkedTransferEncoded;
             result.bodyLength_ = std::string_view::npos;
         }
+        else if (utils::ascii::IsEqual(key, Header::kConnectionKey)) {
+            if (utils::ascii::IsEqual(raw, Header::kCloseValue)) {
+                result.keepAlive_ = false;
+            }
+            else if (utils::ascii::IsEqual(raw, Header::kKeepAliveValue)) {
+                result.keepAlive_ = true;
+            }
+        }
 
         // update start
         start = finish + kFieldDelimiter.size();
@@ -78,6 +88,117 @@ Header ParseHeader(std::string_view src) {
     return result;
 }
 
+size_t ChunkedDecoder::Feed(std::string_view src, Body& body) {
+    // chunk-size must fit the body
+    constexpr std::uint64_t kMaxChunkSize { std::uint64_t{ 1 } << 60 };
+
+    size_t i { 0 };
+    while (i < src.size() && state_ != State::kDone && state_ != State::kError) {
+        const char c { src[i] };
+        switch (state_) {
+            case State::kSize: {
+                int digit { -1 };
+                if (c >= '0' && c <= '9') digit = c - '0';
+                else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+
+                if (digit >= 0 && remaining_ < kMaxChunkSize) {
+                    remaining_ = remaining_ * 16 + static_cast<std::uint64_t>(digit);
+                    digits_++;
+                }
+                else if (digits_ && (c == ';' || c == ' ' || c == '\t')) {
+                    state_ = State::kExtension;
+                }
+                else if (digits_ && c == '\r') {
+                    state_ = State::kSizeLF;
+                }
+                else {
+                    state_ = State::kError;
+                }
+                i++;
+            } break;
+            case State::kExtension: {
+                // skip the whole extension at once
+                const auto cr = src.find('\r', i);
+                if (cr == std::string_view::npos) {
+                    i = src.size();
+                }
+                else {
+                    state_ = State::kSizeLF;
+                    i = cr + 1;
+                }
+            } break;
+            case State::kSizeLF: {
+                if (c != '\n') {
+                    state_ = State::kError;
+                }
+                else {
+                    state_ = remaining_? State::kData : State::kTrailer;
+                }
+                i++;
+            } break;
+            case State::kData: {
+                // copy as much of the chunk as is available
+                const auto count = static_cast<size_t>(std::min<std::uint64_t>(
+                    remaining_, src.size() - i));
+                body.append(src.data() + i, count);
+                remaining_ -= count;
+                i += count;
+                if (!remaining_) {
+                    state_ = State::kDataCR;
+                }
+            } break;
+            case State::kDataCR: {
+                state_ = (c == '\r'? State::kDataLF : State::kError);
+                i++;
+            } break;
+            case State::kDataLF: {
+                if (c != '\n') {
+                    state_ = State::kError;
+                }
+                else {
+                    state_ = State::kSize;
+                    digits_ = 0;
+                }
+                i++;
+            } break;
+            case State::kTrailer: {
+                state_ = (c == '\r'? State::kLastLF : State::kTrailerField);
+                i++;
+            } break;
+            case State::kTrailerField: {
+                const auto cr = src.find('\r', i);
+                if (cr == std::string_view::npos) {
+                    i = src.size();
+                }
+                else {
+                    state_ = State::kTrailerLF;
+                    i = cr + 1;
+                }
+            } break;
+            case State::kTrailerLF: {
+                state_ = (c == '\n'? State::kTrailer : State::kError);
+                i++;
+            } break;
+            case State::kLastLF: {
+                state_ = (c == '\n'? State::kDone : State::kError);
+                i++;
+            } break;
+            default: 
+                assert(false && "Unreachable");
+        }
+    }
+    return i;
+}
+
+ChunkedDecoder::Status ChunkedDecoder::GetStatus() const noexcept {
+    switch (state_) {
+        case State::kDone: return Status::kDone;
+        case State::kError: return Status::kError;
+        default: return Status::kNeedMore;
+    }
+}
+
 } // namespace http
 
 namespace irc {
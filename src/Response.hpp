@@ -29,6 +29,9 @@ namespace net {
             static constexpr std::string_view kTransferEncodedKey = "transfer-encoding";
             static constexpr std::string_view kTransferEncodedValue = "chunked";
             static constexpr std::string_view kContentLengthKey = "content-length";
+            static constexpr std::string_view kConnectionKey = "connection";
+            static constexpr std::string_view kCloseValue = "close";
+            static constexpr std::string_view kKeepAliveValue = "keep-alive";
 
             // status line
             std::string     httpVersion_;
@@ -39,6 +42,8 @@ namespace net {
             // it's not a `BodyContentKind::unknown` type
             BodyContentKind bodyKind_;
             std::uint64_t   bodyLength_;
+            // connection can be reused for the next request
+            bool            keepAlive_;
         };
 
         Header ParseHeader(std::string_view src);
@@ -49,6 +54,59 @@ namespace net {
             Header  header_;
             Body    body_;
         };
+
+        /**
+         * Incremental decoder of the chunked transfer coding.
+         * [RFC 7230 Chunked Transfer Coding](https://datatracker.ietf.org/doc/html/rfc7230#section-4.1)
+         *
+         * Accepts the input in pieces of any size, so the caller feeds
+         * whatever bytes it has received and reads more only when
+         * the decoder asks for them. Chunk data is appended to the body
+         * as is (it may contain CRLF). Chunk extensions and trailer fields
+         * are parsed and skipped.
+         */
+        class ChunkedDecoder final {
+        public:
+            enum class Status : std::uint8_t {
+                kNeedMore,
+                kDone,
+                kError
+            };
+
+            // return the number of consumed bytes of `src`;
+            // bytes following the last CRLF of the message aren't consumed
+            size_t Feed(std::string_view src, Body& body);
+
+            Status GetStatus() const noexcept;
+
+            void Reset() noexcept {
+                state_ = State::kSize;
+                remaining_ = 0;
+                digits_ = 0;
+            }
+
+        private:
+            enum class State : std::uint8_t {
+                kSize,          // chunk-size (hex)
+                kExtension,     // chunk-ext up to CR
+                kSizeLF,        // LF after chunk-size line
+                kData,          // chunk-data
+                kDataCR,        // CRLF after chunk-data
+                kDataLF,
+                kTrailer,       // start of trailer field or the final CRLF
+                kTrailerField,  // trailer field up to CR
+                kTrailerLF,     // LF after trailer field
+                kLastLF,        // LF of the final CRLF
+                kDone,
+                kError
+            };
+
+            State state_ { State::kSize };
+            // bytes of the current chunk which aren't read yet
+            std::uint64_t remaining_ { 0 };
+            // number of hex digits in the current chunk-size
+            size_t digits_ { 0 };
+        };
         
     }
 
@@ -0,0 +1,58 @@
+#include "Runtime.hpp"
+#include "Console.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+
+namespace {
+
+std::size_t DefaultThreadCount() noexcept {
+    // `hardware_concurrency` may return 0 if it's not computable
+    return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+} // namespace {
+
+Runtime::Runtime(std::size_t threads)
+    : threadCount_ { threads? threads: DefaultThreadCount() }
+    , context_ { std::make_shared<boost::asio::io_context>(
+        static_cast<int>(threadCount_)) }
+    , work_ { context_->get_executor() }
+{
+}
+
+Runtime::~Runtime() {
+    Join();
+}
+
+void Runtime::Run() {
+    assert(threads_.empty() && "Runtime is already running");
+    threads_.reserve(threadCount_);
+    for (std::size_t i = 0; i < threadCount_; i++) {
+        threads_.emplace_back([ctx = context_] {
+            for (;;) {
+                try {
+                    ctx->run();
+                    break;
+                }
+                catch (std::exception& ex) {
+                    // exception escaped from some handler: 
+                    // log it and keep the thread in the pool
+                    service::Console::Write("[runtime] --error: "
+                        "context raises an exception:", ex.what(), '\n');
+                }
+            }
+        });
+    }
+}
+
+void Runtime::Join() {
+    work_.reset();
+    for (auto& t: threads_) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+    threads_.clear();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <thread>
+
+#include <boost/asio.hpp>
+
+/**
+ * Execution runtime shared by all services.
+ * 
+ * Owns the only `io_context` and the pool of threads running it. 
+ * Services don't own threads: they post work to the shared context
+ * (serialized by the service's own strand and the strands of its connections) 
+ * and keep it alive with their own work guard, so each service can be 
+ * shut down separately by releasing its guard while others keep running.
+ * 
+ * Threads return when the runtime's own guard is released by `Join`
+ * and all services released theirs, i.e. all posted work is finished.
+ */
+class Runtime {
+public:
+    using SharedContext = std::shared_ptr<boost::asio::io_context>;
+    using Work = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+    using Strand = boost::asio::io_context::strand;
+
+    // `threads == 0` means one thread per core
+    explicit Runtime(std::size_t threads = 0);
+
+    Runtime(const Runtime&) = delete;
+    Runtime(Runtime&&) = delete;
+    Runtime& operator=(const Runtime&) = delete;
+    Runtime& operator=(Runtime&&) = delete;
+
+    ~Runtime();
+
+    // Start the pool. Doesn't block.
+    void Run();
+
+    // Release runtime's work guard and wait until 
+    // all services finish their work
+    void Join();
+
+    SharedContext GetContext() const noexcept {
+        return context_;
+    }
+
+    // Work guard which keeps the pool alive until the service resets it
+    Work MakeWork() const {
+        return Work { context_->get_executor() };
+    }
+
+    // Strand of the service: its handlers don't run concurrently
+    // while handlers of the other services still run in parallel
+    Strand MakeStrand() const {
+        return Strand { *context_ };
+    }
+
+    std::size_t GetThreadCount() const noexcept {
+        return threadCount_;
+    }
+
+private:
+    const std::size_t threadCount_ { 1 };
+    SharedContext context_;
+    Work work_;
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,498 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <array>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+#include <functional>
+#include <cassert>
+#include <algorithm>
+#include <cstddef>
+
+#include "ConcurrentQueue.hpp"
+
+/**
+ * Identity of the value for `Overflow::kCoalesce`: the value is
+ * coalesced only with a queued one which has an equal key.
+ * Specialize it for the types which can't be copied.
+ */
+template<typename T>
+struct CoalesceKey {
+    using type = T;
+
+    static type Make(const T& value) {
+        return value;
+    }
+};
+
+/**
+ * Work-stealing scheduler with the same producer interface as `CcQueue`.
+ *
+ * Each worker owns a bounded lock-free ring (`CcQueue` without sentinel).
+ * - Producer which is a worker of this scheduler pushes to its own ring
+ *   (e.g., cached response which is pushed back as a `chat` command);
+ * - any other producer (console, io_context threads) spreads
+ *   values over the rings in round-robin;
+ * - worker drains its own ring first and steals from the others
+ *   when its ring is empty.
+ * Workers are parked only when all rings are empty.
+ *
+ * Values are divided into `Lanes` priority classes (lane 0 is the highest).
+ * Each lane has its own set of rings and its own capacity.
+ * Workers always drain (and steal from) the higher lane before looking
+ * at the lower one, so backlog of the lower lane doesn't delay the higher one.
+ *
+ * When the lane is full the producer's `Overflow` policy decides
+ * what happens with the value. Every dropped, displaced or coalesced
+ * value is counted in the lane's `Stats`.
+ *
+ * Note: the order is FIFO per ring, i.e. values pushed by
+ * different producers may be consumed in different order.
+ */
+template<typename T, std::size_t Capacity, std::size_t Lanes = 1>
+class Scheduler {
+public:
+    static_assert(Lanes > 0, "Scheduler requires at least one lane");
+
+    using element = T;
+    using Capacities = std::array<std::size_t, Lanes>;
+
+    static constexpr std::size_t kCapacity { Capacity };
+    static constexpr std::size_t kLanes { Lanes };
+
+    // Producer's reaction on the full lane
+    struct Overflow {
+        enum Policy {
+            // reject the pushed value
+            kDropNewest,
+            // displace the oldest value of the lane by the pushed one
+            kDropOldest,
+            // wait for free space not longer than `timeout`
+            // then reject the pushed value
+            kBlock,
+            // reject the pushed value if an equal one is already queued,
+            // otherwise behave like `kDropNewest`. 
+            // Requires `std::hash` of the `CoalesceKey<T>::type`.
+            kCoalesce
+        };
+
+        Policy policy { kDropNewest };
+        std::chrono::milliseconds timeout { 0 };
+    };
+
+    enum class Status {
+        kPushed,
+        // pushed, but the oldest value of the lane was dropped
+        kDisplaced,
+        // not pushed, an equal value is already queued
+        kCoalesced,
+        // not pushed, the lane is full
+        kDropped
+    };
+
+    // Snapshot of lane's counters
+    struct Stats {
+        std::size_t pushed { 0 };
+        // rejected new values (including the timed out ones)
+        std::size_t dropped { 0 };
+        // dropped old values
+        std::size_t displaced { 0 };
+        std::size_t coalesced { 0 };
+        // rejected by `kBlock` policy after waiting
+        std::size_t timeouts { 0 };
+        // number of queued values at the moment
+        std::size_t size { 0 };
+        // max number of values queued at once
+        std::size_t highWater { 0 };
+    };
+
+    // every lane is limited only by capacity of its rings
+    Scheduler(std::size_t workers, bool sentinel = true)
+        : Scheduler { workers, Unlimited(), sentinel }
+    {}
+
+    Scheduler(std::size_t workers, const Capacities& capacities, bool sentinel = true)
+        : workers_ { workers }
+        , sentinel_ { sentinel }
+    {
+        assert(workers_ > 0 && "Scheduler requires at least one worker");
+        for (std::size_t lane = 0; lane < kLanes; lane++) {
+            auto& rings = lanes_[lane].rings;
+            rings.reserve(workers_);
+            for (std::size_t i = 0; i < workers_; i++) {
+                // rings never block: the scheduler parks workers itself
+                rings.emplace_back(std::make_unique<Ring>(false));
+            }
+            lanes_[lane].capacity = std::min(capacities[lane], workers_ * kCapacity);
+        }
+    }
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+    Scheduler(Scheduler&&) = delete;
+    Scheduler& operator=(Scheduler&&) = delete;
+
+    // return true if value was pushed successfully to the `lane`
+    // (lane isn't full) otherwise return false on failure and doesn't block
+    // Note: `value` is moved from only on success
+    [[nodiscard]] bool TryPush(element&& value, std::size_t lane = 0) {
+        return Push(std::move(value), lane) == Status::kPushed;
+    }
+
+    // Push value to the `lane` resolving the overflow according to `overflow`.
+    // Blocks only for `Overflow::kBlock` policy.
+    // Note: `value` is moved from only if it was pushed
+    Status Push(element&& value, std::size_t lane, Overflow overflow = {}) {
+        assert(lane < kLanes);
+        auto& target = lanes_[lane];
+
+        Entry entry { std::move(value), false };
+        if (overflow.policy == Overflow::kCoalesce) {
+            entry.tracked = true;
+            std::lock_guard<std::mutex> lock { pendingMutex_ };
+            // reserve the key so the concurrent duplicate will be coalesced
+            if (!pending_.insert(Key::Make(entry.value)).second) {
+                target.coalesced.fetch_add(1, std::memory_order_relaxed);
+                value = std::move(entry.value);
+                return Status::kCoalesced;
+            }
+        }
+
+        auto status { Status::kPushed };
+        bool isPushed = TryEnqueue(target, entry);
+        if (!isPushed && overflow.policy == Overflow::kDropOldest) {
+            // a few attempts because the popped place can be taken
+            // by another producer right away
+            for (std::size_t i = 0; !isPushed && i < kDisplaceAttempts; i++) {
+                if (Displace(target)) {
+                    status = Status::kDisplaced;
+                }
+                isPushed = TryEnqueue(target, entry);
+            }
+        }
+        else if (!isPushed && overflow.policy == Overflow::kBlock && !IsWorker()) {
+            // Note: worker can't wait for itself, so it just drops the value
+            isPushed = WaitEnqueue(target, entry, overflow.timeout);
+            if (!isPushed) {
+                target.timeouts.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (!isPushed) {
+            if (entry.tracked) {
+                Forget(entry.value);
+            }
+            target.dropped.fetch_add(1, std::memory_order_relaxed);
+            value = std::move(entry.value);
+            return Status::kDropped;
+        }
+        target.pushed.fetch_add(1, std::memory_order_relaxed);
+        return status;
+    }
+
+    // Move up to `max` elements to `out` for the `worker`.
+    // Blocks while all rings are empty and scheduler has sentinel.
+    // return number of popped elements;
+    // zero means that scheduler is empty and doesn't have sentinel
+    template<typename OutputIt>
+    [[nodiscard]] std::size_t TryPopBulk(std::size_t worker
+        , OutputIt out
+        , std::size_t max
+    ) {
+        assert(worker < workers_);
+        worker_ = { this, worker };
+        if (max == 0) {
+            return 0;
+        }
+        for (;;) {
+            if (const auto popped = Steal(worker, out, max); popped) {
+                return popped;
+            }
+            if (!sentinel_.load()) {
+                // the last chance: producer may have pushed value
+                // right before the sentinel was disabled
+                return Steal(worker, out, max);
+            }
+            Park();
+        }
+    }
+
+    void DisableSentinel() {
+        {
+            std::unique_lock lock { mutex_ };
+            sentinel_.store(false);
+        }
+        notifier_.notify_all();
+        // release blocked producers too
+        space_.notify_all();
+    }
+
+    std::size_t GetWorkerCount() const noexcept {
+        return workers_;
+    }
+
+    std::size_t GetCapacity(std::size_t lane) const noexcept {
+        assert(lane < kLanes);
+        return lanes_[lane].capacity;
+    }
+
+    Stats GetStats(std::size_t lane) const noexcept {
+        assert(lane < kLanes);
+        const auto& source = lanes_[lane];
+        Stats stats;
+        stats.pushed = source.pushed.load(std::memory_order_relaxed);
+        stats.dropped = source.dropped.load(std::memory_order_relaxed);
+        stats.displaced = source.displaced.load(std::memory_order_relaxed);
+        stats.coalesced = source.coalesced.load(std::memory_order_relaxed);
+        stats.timeouts = source.timeouts.load(std::memory_order_relaxed);
+        stats.size = static_cast<std::size_t>(std::max<std::ptrdiff_t>(0, source.size.load()));
+        stats.highWater = source.highWater.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+
+    using Key = CoalesceKey<element>;
+
+    // Value with scheduler's bookkeeping
+    struct Entry {
+        element value {};
+        // key of the value is registered in `pending_`
+        bool tracked { false };
+    };
+
+    using Ring = CcQueue<Entry, Capacity>;
+
+    struct Lane {
+        std::vector<std::unique_ptr<Ring>> rings;
+        std::size_t capacity { 0 };
+        // number of values reserved in the lane
+        alignas(64) std::atomic<std::ptrdiff_t> size { 0 };
+        // counters
+        alignas(64) std::atomic<std::size_t> pushed { 0 };
+        std::atomic<std::size_t> dropped { 0 };
+        std::atomic<std::size_t> displaced { 0 };
+        std::atomic<std::size_t> coalesced { 0 };
+        std::atomic<std::size_t> timeouts { 0 };
+        std::atomic<std::size_t> highWater { 0 };
+    };
+
+    struct WorkerId {
+        const Scheduler *owner { nullptr };
+        std::size_t index { 0 };
+    };
+
+    // Output iterator which passes the values to the consumer's iterator
+    // and releases their coalescing keys
+    template<typename OutputIt>
+    class Unwrapper {
+    public:
+        Unwrapper(Scheduler *scheduler, OutputIt out)
+            : scheduler_ { scheduler }
+            , out_ { out }
+        {}
+
+        Unwrapper& operator*() noexcept { return *this; }
+        Unwrapper& operator++() noexcept { return *this; }
+
+        Unwrapper& operator=(Entry&& entry) {
+            if (entry.tracked) {
+                scheduler_->Forget(entry.value);
+            }
+            *out_ = std::move(entry.value);
+            ++out_;
+            return *this;
+        }
+
+    private:
+        Scheduler * const scheduler_ { nullptr };
+        OutputIt out_;
+    };
+
+    // Stub consumer used to throw displaced values away
+    struct Discard {
+        Discard& operator*() noexcept { return *this; }
+        Discard& operator++() noexcept { return *this; }
+
+        template<typename U>
+        Discard& operator=(U&&) noexcept { return *this; }
+    };
+
+    static Capacities Unlimited() noexcept {
+        Capacities capacities;
+        capacities.fill(static_cast<std::size_t>(-1));
+        return capacities;
+    }
+
+    bool IsWorker() const noexcept {
+        return worker_.owner == this;
+    }
+
+    bool HasValues() const noexcept {
+        for (const auto& lane: lanes_) {
+            if (lane.size.load() > 0) return true;
+        }
+        return false;
+    }
+
+    // Doesn't block. `entry` is moved from only on success
+    bool TryEnqueue(Lane& lane, Entry& entry) {
+        // reserve a place in the lane before the value becomes visible
+        // so the counter never falls behind the content
+        const auto reserved { lane.size.fetch_add(1) + 1 };
+        if (reserved > static_cast<std::ptrdiff_t>(lane.capacity)) {
+            lane.size.fetch_sub(1);
+            return false;
+        }
+        UpdateHighWater(lane, static_cast<std::size_t>(reserved));
+        const std::size_t first { IsWorker()
+            ? worker_.index
+            : next_.fetch_add(1, std::memory_order_relaxed) % workers_
+        };
+        for (std::size_t i = 0; i < workers_; i++) {
+            if (lane.rings[(first + i) % workers_]->TryPush(std::move(entry))) {
+                Notify();
+                return true;
+            }
+        }
+        lane.size.fetch_sub(1);
+        return false;
+    }
+
+    // Rarely writes: only when the lane reaches a new peak
+    static void UpdateHighWater(Lane& lane, std::size_t reserved) noexcept {
+        auto peak = lane.highWater.load(std::memory_order_relaxed);
+        while (reserved > peak 
+            && !lane.highWater.compare_exchange_weak(peak, reserved, std::memory_order_relaxed)
+        ) {}
+    }
+
+    // Block producer until the value is pushed or `timeout` expires
+    bool WaitEnqueue(Lane& lane, Entry& entry, std::chrono::milliseconds timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        const auto hasSpace = [this, &lane]() {
+            return lane.size.load() < static_cast<std::ptrdiff_t>(lane.capacity)
+                || !sentinel_.load();
+        };
+        // pairs with `Lane::size` decrement and `blocked_` load in `NotifyProducers`
+        blocked_.fetch_add(1);
+        bool isPushed = TryEnqueue(lane, entry);
+        bool isExpired = false;
+        while (!isPushed && !isExpired && sentinel_.load()) {
+            {
+                std::unique_lock<std::mutex> lock { mutex_ };
+                isExpired = !space_.wait_until(lock, deadline, hasSpace);
+            }
+            // the last attempt is made even after expiration
+            isPushed = TryEnqueue(lane, entry);
+        }
+        blocked_.fetch_sub(1);
+        return isPushed;
+    }
+
+    // Drop the oldest value of the lane. Doesn't block.
+    bool Displace(Lane& lane) {
+        for (std::size_t i = 0; i < workers_; i++) {
+            auto& ring = lane.rings[(next_.load(std::memory_order_relaxed) + i) % workers_];
+            if (ring->TryPopBulk(Unwrapper<Discard>{ this, Discard{} }, 1)) {
+                lane.size.fetch_sub(1);
+                lane.displaced.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Forget(const element& value) {
+        auto key { Key::Make(value) };
+        std::lock_guard<std::mutex> lock { pendingMutex_ };
+        pending_.erase(key);
+    }
+
+    // Take values from the highest non-empty lane:
+    // from the own ring first, then from the others. Doesn't block.
+    template<typename OutputIt>
+    std::size_t Steal(std::size_t worker, OutputIt out, std::size_t max) {
+        for (auto& lane: lanes_) {
+            if (lane.size.load() <= 0) continue;
+            for (std::size_t i = 0; i < workers_; i++) {
+                auto& ring = lane.rings[(worker + i) % workers_];
+                if (const auto popped = ring->TryPopBulk(Unwrapper<OutputIt>{ this, out }, max);
+                    popped
+                ) {
+                    lane.size.fetch_sub(static_cast<std::ptrdiff_t>(popped));
+                    NotifyProducers();
+                    return popped;
+                }
+            }
+        }
+        return 0;
+    }
+
+    void Park() {
+        const auto ready = [this]() {
+            return HasValues() || !sentinel_.load();
+        };
+        std::unique_lock<std::mutex> lock { mutex_ };
+        // pairs with `Lane::size` increment and `waiters_` load in `Notify`
+        waiters_.fetch_add(1);
+        if (!ready()) {
+            notifier_.wait(lock, ready);
+        }
+        waiters_.fetch_sub(1);
+        if (HasValues()) {
+            // counter may be ahead of the published value
+            lock.unlock();
+            std::this_thread::yield();
+        }
+    }
+
+    void Notify() {
+        if (waiters_.load() == 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock { mutex_ };
+        }
+        notifier_.notify_one();
+    }
+
+    void NotifyProducers() {
+        if (blocked_.load() == 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock { mutex_ };
+        }
+        space_.notify_all();
+    }
+
+    static constexpr std::size_t kDisplaceAttempts { 3 };
+
+    const std::size_t workers_ { 0 };
+    std::array<Lane, kLanes> lanes_;
+    // producer's cursor for the round-robin
+    alignas(64) std::atomic<std::size_t> next_ { 0 };
+    alignas(64) std::atomic<std::size_t> waiters_ { 0 };
+    // number of producers blocked by `Overflow::kBlock` policy
+    std::atomic<std::size_t> blocked_ { 0 };
+    std::atomic<bool> sentinel_ { false };
+
+    std::mutex mutex_;
+    // notifies consumers about new values
+    std::condition_variable notifier_;
+    // notifies blocked producers about free space
+    std::condition_variable space_;
+
+    // keys of the queued values pushed with `Overflow::kCoalesce`;
+    // whole keys are compared so hash collision doesn't coalesce different values
+    std::mutex pendingMutex_;
+    std::unordered_set<typename Key::type> pending_;
+
+    // identity of the worker running on the current thread
+    static inline thread_local WorkerId worker_ {};
+};
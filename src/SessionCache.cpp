@@ -0,0 +1,88 @@
+#include "SessionCache.hpp"
+
+namespace {
+
+// slot of the SSL_CTX's ex_data where the cache is attached
+int CacheIndex() {
+    static const int index { 
+        SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr) };
+    return index;
+}
+
+} // namespace {
+
+SessionCache::SessionCache(boost::asio::ssl::context& ctx) 
+    : ctx_ { ctx.native_handle() }
+{
+    SSL_CTX_set_ex_data(ctx_, CacheIndex(), this);
+    // don't keep sessions in the OpenSSL's internal cache: 
+    // client-side lookup is done by host here
+    SSL_CTX_set_session_cache_mode(ctx_
+        , SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx_, &SessionCache::OnNewSession);
+}
+
+SessionCache::~SessionCache() {
+    SSL_CTX_sess_set_new_cb(ctx_, nullptr);
+    SSL_CTX_set_session_cache_mode(ctx_, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_ex_data(ctx_, CacheIndex(), nullptr);
+    Clear();
+}
+
+void SessionCache::Clear() {
+    std::lock_guard<std::mutex> lock { mutex_ };
+    sessions_.clear();
+}
+
+SessionCache* SessionCache::From(SSL *ssl) {
+    return static_cast<SessionCache*>(
+        SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), CacheIndex()));
+}
+
+bool SessionCache::Resume(SSL *ssl, std::string_view host) {
+    auto cache = From(ssl);
+    if (!cache) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock { cache->mutex_ };
+    // TODO: use heterogeneous lookup (C++20)
+    auto it = cache->sessions_.find(std::string{ host });
+    if (it == cache->sessions_.end() || it->second.empty()) {
+        return false;
+    }
+    auto& sessions = it->second;
+    Session session { std::move(sessions.back()) };
+    sessions.pop_back();
+    // SSL takes its own reference
+    const bool isSet { SSL_set_session(ssl, session.get()) == 1 };
+    if (SSL_SESSION_get_protocol_version(session.get()) < TLS1_3_VERSION) {
+        // not a single-use ticket: other connections may resume it too
+        sessions.push_back(std::move(session));
+    }
+    return isSet;
+}
+
+void SessionCache::Forget(SSL *ssl, std::string_view host) {
+    if (auto cache = From(ssl); cache) {
+        std::lock_guard<std::mutex> lock { cache->mutex_ };
+        cache->sessions_.erase(std::string{ host });
+    }
+}
+
+int SessionCache::OnNewSession(SSL *ssl, SSL_SESSION *session) {
+    const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    auto cache = From(ssl);
+    if (!cache || !host || !SSL_SESSION_is_resumable(session)) {
+        // OpenSSL frees the session
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock { cache->mutex_ };
+    auto& sessions = cache->sessions_[host];
+    if (sessions.size() == kSessionsPerHost) {
+        // the oldest ticket is the most likely to be expired
+        sessions.pop_front();
+    }
+    sessions.emplace_back(session);
+    // the reference is owned by cache now
+    return 1;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <boost/asio/ssl.hpp>
+
+/**
+ * Client-side cache of TLS sessions keyed by host (SNI).
+ * 
+ * OpenSSL reports every new session (ID or ticket) of the context 
+ * via callback, so TLS 1.3 tickets which arrive after the handshake
+ * are cached as well. The next connection to the same host offers 
+ * the cached session and does an abbreviated handshake if the server 
+ * accepts it, otherwise the handshake silently falls back to the full one.
+ * 
+ * TLS 1.3 tickets are single-use (RFC 8446, Appendix C.4): 
+ * a few of them are kept per host and each is taken by one connection, 
+ * so concurrent connections don't offer the same ticket. 
+ * Older sessions may be resumed many times and stay cached.
+ * 
+ * The cache is owned by the service next to its SSL context and is
+ * attached to the context: connections find it by their `SSL`.
+ * Sessions are freed by `Clear` or on destruction, i.e. before 
+ * OpenSSL is cleaned up at exit.
+ */
+class SessionCache {
+public:
+    // Cache sessions of all connections created with `ctx`
+    explicit SessionCache(boost::asio::ssl::context& ctx);
+
+    SessionCache(const SessionCache&) = delete;
+    SessionCache(SessionCache&&) = delete;
+    SessionCache& operator=(const SessionCache&) = delete;
+    SessionCache& operator=(SessionCache&&) = delete;
+
+    // Detach from the context (it may outlive the cache) and free sessions
+    ~SessionCache();
+
+    // Free all sessions
+    void Clear();
+
+    // Offer the newest cached session of the host for the next handshake.
+    // return true if there is a session
+    static bool Resume(SSL *ssl, std::string_view host);
+
+    // Drop the sessions of the host, e.g. when the handshake failed
+    static void Forget(SSL *ssl, std::string_view host);
+
+private:
+    // cache attached to the context of `ssl`, if any
+    static SessionCache* From(SSL *ssl);
+
+    // OpenSSL's new session callback
+    static int OnNewSession(SSL *ssl, SSL_SESSION *session);
+
+    struct Deleter {
+        void operator()(SSL_SESSION *session) const noexcept {
+            SSL_SESSION_free(session);
+        }
+    };
+    using Session = std::unique_ptr<SSL_SESSION, Deleter>;
+
+    // a server usually issues 2 tickets per handshake:
+    // enough for a few simultaneous connections to the host
+    static constexpr std::size_t kSessionsPerHost { 4 };
+
+    SSL_CTX * const ctx_ { nullptr };
+    std::mutex mutex_;
+    // the newest sessions are at the back
+    std::unordered_map<std::string, std::deque<Session>> sessions_;
+};
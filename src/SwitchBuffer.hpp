@@ -1,126 +1,241 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <array>
 #include <vector>
 #include <cassert>
-#include <functional>
+#include <limits>
+#include <utility>
 
 #include <boost/asio.hpp>
 
+#include "InplaceCallback.hpp"
+
+/**
+ * Double buffer of outgoing messages: the passive buffer collects
+ * messages while the active one is being written.
+ *
+ * Messages of a buffer are stored back-to-back in one byte slab
+ * so the active buffer is written as a single contiguous buffer.
+ * Slabs, message bounds and callbacks keep their capacity between
+ * swaps, so in steady state queueing doesn't allocate.
+ *
+ * The passive buffer is split into priority lanes: on swap the lanes
+ * are concatenated in priority order, so control messages overtake
+ * queued regular ones. Each lane is bounded by its `Limits`.
+ */
 class SwitchBuffer {
 public:
     using ConstBuffer = boost::asio::const_buffer;
-    using FuncRef = std::reference_wrapper<std::function<void()>>;
+    using Callback = InplaceCallback;
+
+    // lower value is sent first
+    enum Priority : size_t {
+        // protocol messages which keep the connection alive or authorized
+        kControl,
+        kNormal,
+        kPriorityCount
+    };
+
+    enum class Overflow {
+        // reject the queued message
+        kDropNewest,
+        // drop the oldest messages of the lane to make room
+        kDropOldest
+    };
+
+    struct Limits {
+        size_t messages { std::numeric_limits<size_t>::max() };
+        size_t bytes { std::numeric_limits<size_t>::max() };
+        Overflow overflow { Overflow::kDropNewest };
+    };
+
+    enum class Status {
+        kQueued,
+        // queued, but the oldest messages of the lane were dropped
+        kDisplaced,
+        // not queued, the lane is full
+        kDropped
+    };
 
     SwitchBuffer(size_t reserved = 10) {
-        for (auto& buffer: buffers_) {
-            buffer.Reserve(reserved);
+        active_.Reserve(reserved);
+        for (auto& lane: lanes_) {
+            lane.Reserve(reserved);
         }
-        bufferSequence_.Reserve(reserved);
+    }
+
+    void SetLimits(Priority priority, Limits limits) noexcept {
+        assert(priority < kPriorityCount);
+        limits_[priority] = limits;
     }
 
     /**
-     * Queue data to passive buffer. 
+     * Queue data to passive buffer.
+     * @note callbacks of dropped messages are destroyed without being invoked
      */
-    void Enque(std::string data, std::function<void()> callback) {
-        assert(activeBuffer_ < buffers_.size());
-        buffers_[activeBuffer_ ^ 1].Append(std::move(data), std::move(callback));
+    Status Enque(std::string_view data, Callback callback, Priority priority = kNormal) {
+        assert(priority < kPriorityCount);
+        auto& lane = lanes_[priority];
+        const auto& limits = limits_[priority];
+        if (limits.messages == 0 || data.size() > limits.bytes) {
+            return Status::kDropped;
+        }
+        auto status { Status::kQueued };
+        while (lane.Size() + 1 > limits.messages 
+            || lane.slab.size() + data.size() > limits.bytes
+        ) {
+            if (limits.overflow == Overflow::kDropNewest) {
+                return Status::kDropped;
+            }
+            lane.PopFront();
+            status = Status::kDisplaced;
+        }
+        lane.Append(data, std::move(callback));
+        return status;
     }
 
     /**
-     * Swap buffers and update @bufferSequence_.
+     * Release the active buffer and move all queued messages there
+     * in priority order.
      */
     void SwapBuffers() {
-        assert(activeBuffer_ < buffers_.size());
-
-        bufferSequence_.Clear();
-        buffers_[activeBuffer_].Clear();
-        activeBuffer_ ^= 1;
-
-        auto& buffer = buffers_[activeBuffer_];
-        for (size_t i = 0; i < buffer.Size(); i++) {
-            bufferSequence_.Append(buffer.data[i], buffer.callbacks[i]);
+        active_.Clear();
+        bool isEmpty { true };
+        for (auto& lane: lanes_) {
+            if (!lane.Size()) continue;
+            if (isEmpty) {
+                // the common case: no copy, buffers trade their storage
+                std::swap(active_, lane);
+                isEmpty = false;
+            }
+            else {
+                active_.Append(std::move(lane));
+                lane.Clear();
+            }
         }
     }
 
     size_t GetQueueSize() const noexcept {
-        assert(activeBuffer_ < buffers_.size());
-        return buffers_[activeBuffer_ ^ 1].Size();
-    } 
+        size_t size { 0 };
+        for (const auto& lane: lanes_) size += lane.Size();
+        return size;
+    }
 
-    const std::vector<ConstBuffer>& GetBufferSequence() const noexcept {
-        return bufferSequence_.data;
+    size_t GetQueueSize(Priority priority) const noexcept {
+        assert(priority < kPriorityCount);
+        return lanes_[priority].Size();
     }
 
-    const std::vector<FuncRef>& GetCallbackSequence() const noexcept {
-        return bufferSequence_.callbacks;
+    // number of bytes queued to the passive buffer
+    size_t GetQueueBytes() const noexcept {
+        size_t bytes { 0 };
+        for (const auto& lane: lanes_) bytes += lane.slab.size();
+        return bytes;
     }
 
-private:
-    // TODO: get rid of code duplication
-    struct BufferData {
-        std::vector<std::string> data;
-        std::vector<std::function<void()>> callbacks;
+    // all messages of the active buffer
+    ConstBuffer GetBuffer() const noexcept {
+        return { active_.slab.data(), active_.slab.size() };
+    }
 
-        void Append(std::string text, std::function<void()> callback) {
-            data.push_back(std::move(text));
-            callbacks.push_back(std::move(callback));
-        }
+    size_t GetMessageCount() const noexcept {
+        return active_.Size();
+    }
 
-        void Reserve(size_t n) {
-            data.reserve(n);
-            callbacks.reserve(n);
+    std::string_view GetMessage(size_t index) const noexcept {
+        assert(index < active_.Size());
+        const size_t start { index? active_.ends[index - 1] : 0 };
+        return std::string_view { active_.slab }.substr(start, active_.ends[index] - start);
+    }
+
+    /**
+     * Drop all messages, both written and queued ones.
+     * @note callbacks are destroyed without being invoked.
+     * MUST NOT be called while the active buffer is being written.
+     */
+    void Clear() noexcept {
+        active_.Clear();
+        for (auto& lane: lanes_) {
+            lane.Clear();
         }
+    }
 
-        void Clear() noexcept {
-            data.clear();
-            callbacks.clear();
+    /**
+     * Invoke callbacks of the active buffer in the order
+     * their messages are written, then drop the written messages:
+     * callbacks mustn't keep their owners alive until the next write.
+     */
+    void InvokeCallbacks() {
+        for (auto& callback: active_.callbacks) {
+            if (callback) {
+                callback();
+            }
         }
+        active_.Clear();
+    }
 
-        size_t Size() const noexcept {
-            assert(data.size() == callbacks.size());
-            return data.size();
+private:
+    // IRC message can't be longer
+    static constexpr size_t kReservedMessageSize { 512 };
+
+    struct BufferData {
+        // messages written back-to-back
+        std::string slab;
+        // end of each message in the slab
+        std::vector<size_t> ends;
+        std::vector<Callback> callbacks;
+
+        void Append(std::string_view text, Callback callback) {
+            slab.append(text);
+            ends.push_back(slab.size());
+            callbacks.push_back(std::move(callback));
         }
-    };
 
-    struct BufferView {
-        std::vector<ConstBuffer> data;
-        std::vector<FuncRef> callbacks;
+        void Append(BufferData&& other) {
+            const size_t offset { slab.size() };
+            slab.append(other.slab);
+            for (auto end: other.ends) {
+                ends.push_back(offset + end);
+            }
+            for (auto& callback: other.callbacks) {
+                callbacks.push_back(std::move(callback));
+            }
+        }
 
-        void Append(const std::string& text, std::function<void()>& callback) {
-            data.emplace_back(text.data(), text.size());
-            callbacks.emplace_back(std::ref(callback));
+        // used only on overflow so linear time is fine
+        void PopFront() {
+            assert(Size());
+            const size_t length { ends.front() };
+            slab.erase(0, length);
+            ends.erase(ends.begin());
+            for (auto& end: ends) {
+                end -= length;
+            }
+            callbacks.erase(callbacks.begin());
         }
 
         void Reserve(size_t n) {
-            data.reserve(n);
+            slab.reserve(n * kReservedMessageSize);
+            ends.reserve(n);
             callbacks.reserve(n);
         }
 
         void Clear() noexcept {
-            data.clear();
+            slab.clear();
+            ends.clear();
             callbacks.clear();
         }
 
         size_t Size() const noexcept {
-            assert(data.size() == callbacks.size());
-            return data.size();
+            assert(ends.size() == callbacks.size());
+            return ends.size();
         }
     };
 
-    using DoubleBuffer = std::array<BufferData, 2>;
-
-    /**
-     * Represent two sequences of some buffers
-     * One sequence is active, another one is passive. 
-     * They can be swapped when needed. 
-     **/    
-    DoubleBuffer buffers_;
-
-    /**
-     * View const buffer sequence used by write operations. 
-     */
-    BufferView bufferSequence_;
-    
-    size_t activeBuffer_ { 0 };
-};
\ No newline at end of file
+    // the buffer being written
+    BufferData active_;
+    // passive buffer: messages waiting for the next write
+    std::array<BufferData, kPriorityCount> lanes_;
+    std::array<Limits, kPriorityCount> limits_ {};
+};
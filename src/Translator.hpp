@@ -1,44 +1,158 @@
 #pragma once
 
-#include <vector>
+#include <array>
+#include <cassert>
+#include <cstdint>
 #include <string_view>
-#include <functional>
-#include <unordered_map>
-#include <optional>
+#include <type_traits>
 
 #include "Command.hpp"
 
+namespace details {
+
+    // FNV-1a mixed with the seed
+    constexpr std::uint64_t Hash(std::string_view text, std::uint64_t seed) noexcept {
+        std::uint64_t hash { 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull) };
+        for (char c: text) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    constexpr std::size_t NextPowerOfTwo(std::size_t value) noexcept {
+        std::size_t power { 1 };
+        while (power < value) power <<= 1;
+        return power;
+    }
+
+} // namespace details
+
+/**
+ * Maps command identity to its handle.
+ *
+ * The set of commands is known at compile time so the dispatch table
+ * is a perfect hash built from `Command::kIdentity`: lookup is one hash,
+ * one index and one string comparison.
+ * Handles are bound to services at run-time. Handle is a pair
+ * of function pointer and service pointer so neither binding
+ * nor lookup touch the heap.
+ */
+template<typename ...Commands>
 class Translator {
 public:
     using Params = command::Args;
-    using Handle = std::function<void(const Params&)>;
-    using Pair   = std::pair<const std::string_view, Handle>;
+
+    static constexpr std::size_t kCount { sizeof...(Commands) };
+
+    // identities of the commands in the order of their indices
+    static constexpr std::array<std::string_view, kCount> kIdentities {
+        Commands::kIdentity...
+    };
+
+    class Handle {
+    public:
+        constexpr Handle() noexcept = default;
+
+        template<typename Command, typename Service>
+        static Handle Create(Service& ctx) noexcept {
+            Handle handle;
+            handle.ctx_ = &ctx;
+            handle.invoke_ = [](void *ctx, const Params& params) {
+                auto& service = *static_cast<Service*>(ctx);
+                Execute(Command::Create(service, params), service);
+            };
+            return handle;
+        }
+
+        void operator()(const Params& params) const {
+            assert(invoke_ && "Handle is not bound");
+            invoke_(ctx_, params);
+        }
+
+        explicit operator bool() const noexcept {
+            return invoke_ != nullptr;
+        }
+
+    private:
+        void *ctx_ { nullptr };
+        void (*invoke_)(void *, const Params&) { nullptr };
+    };
 
     Translator() = default;
 
-    void Insert(const Pair& commandWithHandle) {
-        table_.insert(commandWithHandle);
+    // Bind `Command` to the service which executes it
+    template<typename Command, typename Service>
+    void Insert(Service& ctx) noexcept {
+        static_assert(IndexOf<Command>() < kCount, "Command isn't in the table");
+        handles_[IndexOf<Command>()] = Handle::template Create<Command>(ctx);
     }
 
-    void Insert(std::initializer_list<Pair> commandList) {
-        table_.insert(commandList);
+    // return index of the command; `kCount` if command is unknown
+    static std::size_t Find(std::string_view command) noexcept {
+        const auto index = kLayout.slots[
+            details::Hash(command, kLayout.seed) & (kSlotCount - 1)];
+        if (index == kCount || kIdentities[index] != command) {
+            return kCount;
+        }
+        return index;
     }
 
-    std::optional<Handle> GetHandle(std::string_view command) const {
-        if (auto it = table_.find(command); it != table_.end()) {
-            return std::make_optional<Handle>(it->second);
+    // return nullptr if command is unknown or not bound
+    const Handle* GetHandle(std::size_t index) const noexcept {
+        if (index >= kCount || !handles_[index]) {
+            return nullptr;
         }
-        return std::nullopt;
+        return &handles_[index];
     }
 
-    template<typename Command, typename Service>
-    static Handle CreateHandle(Service& ctx) {
-        return [&ctx](const Params& params) mutable {
-            Execute(Command::Create(ctx, params), ctx);
-        };
+    const Handle* GetHandle(std::string_view command) const noexcept {
+        return GetHandle(Find(command));
     }
 
 private:
-    // maps command to appropriate handle
-    std::unordered_map<std::string_view, Handle> table_;
-};
\ No newline at end of file
+    // keep load factor <= 0.5 so the seed is found quickly
+    static constexpr std::size_t kSlotCount { details::NextPowerOfTwo(2 * kCount) };
+    static constexpr std::uint64_t kMaxSeed { 1 << 16 };
+
+    struct Layout {
+        std::uint64_t seed { kMaxSeed };
+        // index of the command; `kCount` marks empty slot
+        std::array<std::size_t, kSlotCount> slots {};
+    };
+
+    // find the first seed without collisions
+    static constexpr Layout MakeLayout() noexcept {
+        Layout layout;
+        for (std::uint64_t seed = 0; seed < kMaxSeed; seed++) {
+            for (auto& slot: layout.slots) slot = kCount;
+            bool collided { false };
+            for (std::size_t i = 0; i < kCount && !collided; i++) {
+                auto& slot = layout.slots[
+                    details::Hash(kIdentities[i], seed) & (kSlotCount - 1)];
+                collided = (slot != kCount);
+                slot = i;
+            }
+            if (!collided) {
+                layout.seed = seed;
+                return layout;
+            }
+        }
+        return layout;
+    }
+
+    static constexpr Layout kLayout { MakeLayout() };
+    static_assert(kLayout.seed < kMaxSeed, "Command identities must be unique");
+
+    template<typename Command>
+    static constexpr std::size_t IndexOf() noexcept {
+        constexpr std::array<bool, kCount> matches { std::is_same_v<Command, Commands>... };
+        for (std::size_t i = 0; i < kCount; i++) {
+            if (matches[i]) return i;
+        }
+        return kCount;
+    }
+
+    // handles are indexed the same way as `kIdentities`
+    std::array<Handle, kCount> handles_ {};
+};
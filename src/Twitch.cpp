@@ -10,10 +10,13 @@ namespace service {
 Twitch::Twitch(const Config *config
     , command::Queue *outbox
     , command::AliasTable *aliases
+    , const Runtime *runtime
 ) 
-    : context_ { std::make_shared<boost::asio::io_context>() }
-    , work_ { context_->get_executor() }
+    : context_ { runtime->GetContext() }
+    , work_ { runtime->MakeWork() }
+    , strand_ { runtime->MakeStrand() }
     , ssl_ { std::make_shared<ssl::context>(ssl::context::method::sslv23_client) }
+    , sessions_ { *ssl_ }
     , config_ { config }
 {
     assert(config_ && "Config is NULL");
@@ -31,12 +34,14 @@ Twitch::Twitch(const Config *config
     }
 
     shard_ = std::make_unique<twitch::IrcShard>(
-        this, outbox, aliases, context_, ssl_);
+        this, outbox, aliases, context_, strand_, ssl_);
 }
 
 Twitch::~Twitch() {
     Console::Write("  -> close twitch service\n");
-    for (auto& t: threads_) t.join();
+    // Note: runtime must be joined before the service is destroyed
+    // so no handler refers to it
+    sessions_.Clear();
 }
 
 void Twitch::ResetWork() {
@@ -47,32 +52,4 @@ void Twitch::ResetWork() {
     // and shutdown connections gracefully
 }
 
-void Twitch::Run() {
-    for (size_t i = 0; i < kThreads; i++) {
-        /**
-         * Source: https://en.cppreference.com/w/cpp/memory/shared_ptr
-         * All member functions (including copy constructor and copy assignment) 
-         * can be called by multiple threads on different instances of shared_ptr 
-         * without additional synchronization even if these instances are copies 
-         * and share ownership of the same object.
-         * 
-         * So, make copy of shared_ptr for each thread
-        */
-        threads_.emplace_back([ctx = this->context_] {
-            for (;;) {
-                try {
-                    // Should be thread safe because `ctx` is another instance of shared_ptr and 
-                    // it's thread safe to call `io_context::run()`
-                    ctx->run();
-                    break;
-                }
-                catch (std::exception& ex) {
-                    // some system exception
-                    Console::Write("[ERROR]: ", ex.what(), '\n');
-                }
-            }
-        });
-    }
-}
-
 } // namespace service
\ No newline at end of file
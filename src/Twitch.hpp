@@ -5,12 +5,12 @@
 
 #include <memory>
 #include <functional>
-#include <vector>
-#include <thread>
 
 #include "Config.hpp"
 #include "Command.hpp"
 #include "IrcShard.hpp"
+#include "Runtime.hpp"
+#include "SessionCache.hpp"
 
 // forward declaration
 namespace command {
@@ -28,21 +28,22 @@ class Twitch
 public:
     Twitch(const Config *config
         , command::Queue *outbox
-        , command::AliasTable *aliases);
+        , command::AliasTable *aliases
+        , const Runtime *runtime);
     ~Twitch();
     Twitch(const Twitch&) = delete;
     Twitch(Twitch&&) = delete;
     Twitch& operator=(const Twitch&) = delete;
     Twitch& operator=(Twitch&&) = delete;
 
-    void Run();
-
     template<typename Command,
         typename Enable = std::enable_if_t<command::details::is_twitch_api_v<Command>>
     >
     void Execute(Command&& cmd);
 
     // Called only from App::~App
+    // Let the service finish its jobs and stop.
+    // Other services sharing the runtime aren't affected
     void ResetWork();
 
     const Config* GetConfig() const noexcept {
@@ -50,17 +51,14 @@ public:
     }
 
 private:
-    template<class T>
-    using executor_work_guard = boost::asio::executor_work_guard<T>;
-    using executor_type = boost::asio::io_context::executor_type;
-    using Work = executor_work_guard<executor_type>;
-
-    static constexpr size_t kThreads { 2 };
-    std::vector<std::thread> threads_;
-
-    std::shared_ptr<boost::asio::io_context> context_;
-    Work work_;
+    // shared with other services
+    Runtime::SharedContext context_;
+    Runtime::Work work_;
+    // commands and their chains are executed within it
+    Runtime::Strand strand_;
     std::shared_ptr<ssl::context> ssl_;
+    // TLS sessions of the connections created with `ssl_`
+    SessionCache sessions_;
     
     // keep twitch's secret data
     const Config * const config_ { nullptr };
@@ -71,7 +69,13 @@ private:
 
 template<typename Command, typename Enable>
 inline void Twitch::Execute(Command&& cmd) {
-    shard_->Execute(std::forward<Command>(cmd));
+    // don't block the caller (queue's worker or connection's read handler):
+    // run within the service's strand
+    boost::asio::post(strand_, [self = shared_from_this()
+        , cmd = std::decay_t<Command>{ std::forward<Command>(cmd) }
+    ]() mutable {
+        self->shard_->Execute(std::move(cmd));
+    });
 }
 
 } // namespace service
\ No newline at end of file